@@ -0,0 +1,63 @@
+#ifndef ADDRESS_MAP_H
+#define ADDRESS_MAP_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Address.h>
+#include <NetSetGo/NetCore/NodeID.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * AddressMap
+ *
+ * Maps addresses to node IDs, for finding who every packet received is from.
+ * This is a flat, open addressing hash table: each address (packed into 48
+ * bits with its port) hashes to a group of 16 slots, and a byte per slot holds
+ * 7 bits of its hash, so a lookup compares a whole group's bytes at once
+ * (with SSE2 where there is SSE2) and only looks at the keys that match. A
+ * lookup costs the same however many addresses are held.
+ */
+class NETCORE_EXPORT AddressMap
+{
+public:
+   AddressMap();
+
+   void Insert(const Address& address, NodeID nodeID); // replaces any node ID already held for the address
+   bool Erase(const Address& address); // false if it was not held
+   NodeID Find(const Address& address) const; // NODEID_INVALID if not held
+   void Clear();
+
+   int GetSize() const { return mSize; }
+   bool IsEmpty() const { return mSize == 0; }
+   int GetCapacity() const { return int(mControl.size()); } // slots, whether in use or not
+
+private:
+   static const int kGroupSize = 16;
+
+   static unsigned long long Pack(const Address& address) { return (unsigned long long)address.GetAddress() << 16 | address.GetPort(); }
+   static unsigned long long Hash(unsigned long long key);
+   int FindSlot(unsigned long long key, unsigned long long hash) const; // -1 if not held
+   void Rehash(int numSlots);
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<unsigned char> mControl; // per slot: empty, deleted, or the low 7 bits of its key's hash
+   std::vector<unsigned long long> mKeys;
+   std::vector<NodeID> mValues;
+#pragma warning (pop)
+   int mSize;
+   int mNumDeleted; // slots left deleted, which still lengthen probes until the next rehash
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // ADDRESS_MAP_H
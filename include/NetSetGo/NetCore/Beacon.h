@@ -98,6 +98,9 @@ public:
    void Stop();
    void Update(float deltaTime);
 
+   const Socket& GetSocket() const { return mSocket; }
+   float GetTimeUntilNextBeacon() const; // in seconds
+
 protected:
    bool SendBeacon();
 
@@ -0,0 +1,34 @@
+#ifndef BITS_H
+#define BITS_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cassert>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+// helper functions for picking apart the masks used to find things a word at a time
+
+inline int LowestBit(unsigned int bits) // bits must not be 0
+{
+   assert(bits != 0);
+#if defined(__GNUC__)
+   return __builtin_ctz(bits);
+#else
+   int bit = 0;
+   while ((bits & 1) == 0)
+   {
+      bits >>= 1;
+      ++bit;
+   }
+   return bit;
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // BITS_H
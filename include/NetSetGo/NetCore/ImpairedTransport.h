@@ -0,0 +1,131 @@
+#ifndef IMPAIRED_TRANSPORT_H
+#define IMPAIRED_TRANSPORT_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Transport.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * ImpairedTransport
+ *
+ * Wraps another transport and makes what is sent through it suffer the way
+ * it would over a real network: delayed, jittered, lost (at random or in
+ * bursts), duplicated, reordered and held to a bandwidth. Every choice comes
+ * from a seeded generator, so the same seed and the same sends give the same
+ * outcome, which makes this a way to measure the reliability, guaranteed
+ * delivery and flow control systems under loss without tc/netem.
+ *
+ * Only sends are impaired; to impair both directions, wrap both ends. Delayed
+ * datagrams are held here and handed to the wrapped transport by Flush(),
+ * which every send and receive call makes first.
+ */
+class NETCORE_EXPORT ImpairedTransport : public Transport
+{
+public:
+   /**
+    * Impairments
+    *
+    * What to do to each datagram; the defaults do nothing. Losses follow the
+    * Gilbert-Elliott model: the link is either good, losing mLoss of its
+    * datagrams, or bad, losing mBurstLoss of them, and before each datagram
+    * goes from good to bad with chance mBurstStart and back with mBurstEnd.
+    * Leaving mBurstStart at 0 gives uniform loss.
+    */
+   struct Impairments
+   {
+      float mLatency; // seconds every datagram is delayed
+      float mJitter; // up to this many seconds more, at random
+      float mLoss; // chance of losing a datagram while the link is good
+      float mBurstStart; // chance of the link going bad
+      float mBurstEnd; // chance of it coming good again
+      float mBurstLoss; // chance of losing a datagram while the link is bad
+      float mDuplication; // chance of a datagram going out twice
+      float mReordering; // chance of a datagram being held back for mReorderDelay more
+      float mReorderDelay;
+      int mBandwidth; // bytes per second, 0 for no limit
+      int mQueueSize; // bytes waiting on the bandwidth before more are dropped, 0 for no limit
+
+      Impairments();
+   };
+
+   ImpairedTransport(Transport& transport, const Impairments& impairments = Impairments(), unsigned int seed = 1);
+   ~ImpairedTransport();
+
+   void SetImpairments(const Impairments& impairments) { mImpairments = impairments; }
+   const Impairments& GetImpairments() const { return mImpairments; }
+   void Seed(unsigned int seed);
+
+   // by default time is read off the Socket::GetTime() clock; once set here,
+   // it only moves when set again, for tests that run faster than real time
+   void SetTime(double time) { mTime = time; }
+   double GetTime() const;
+
+   int Flush(); // hands every datagram that is due to the wrapped transport, returns how many
+
+   // what has been done so far
+   unsigned int GetNumLost() const { return mNumLost; }
+   unsigned int GetNumDuplicated() const { return mNumDuplicated; }
+   unsigned int GetNumReordered() const { return mNumReordered; }
+   int GetNumPending() const { return int(mPending.size()); }
+
+   // implementations of pure virtual methods
+   bool Open(unsigned short port);
+   void Close(); // anything still held is lost
+   bool IsOpen() const { return mTransport.IsOpen(); }
+   unsigned short GetPort() const { return mTransport.GetPort(); }
+   bool Send(const net::Address& destination, const void* data, int size);
+   int Receive(net::Address& sender, void* data, int size);
+
+   // overriding virtual methods
+   bool SendV(const net::Address& destination, const Buffer buffers[], int count);
+   int ReceiveBatch(Datagram datagrams[], int count);
+   bool ReceivesInPlace() const { return mTransport.ReceivesInPlace(); }
+   int ReceiveInPlace(Datagram datagrams[], int count);
+   void ReleaseReceived() { mTransport.ReleaseReceived(); }
+   bool UsesReceiveOffload() const { return mTransport.UsesReceiveOffload(); }
+   unsigned int GetReceiveDrops() const { return mTransport.GetReceiveDrops(); }
+   unsigned int GetSendDrops() const { return mTransport.GetSendDrops(); }
+
+private:
+   ImpairedTransport(const ImpairedTransport&); // not copyable
+   ImpairedTransport& operator=(const ImpairedTransport&);
+
+   float Random(); // in [0, 1)
+   bool Chance(float probability) { return probability > 0.0f && Random() < probability; }
+
+   struct Held
+   {
+      net::Address mDestination;
+      std::vector<unsigned char> mData;
+   };
+
+   Transport& mTransport;
+   Impairments mImpairments;
+   unsigned long long mState; // of the generator
+   double mTime; // negative while following the real clock
+   bool mBursting; // the link is bad
+   double mLinkFree; // when the bandwidth is next free
+   unsigned int mNumLost;
+   unsigned int mNumDuplicated;
+   unsigned int mNumReordered;
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::multimap<double, Held> mPending; // by when they are due
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // IMPAIRED_TRANSPORT_H
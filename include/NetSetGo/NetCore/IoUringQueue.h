@@ -0,0 +1,110 @@
+#ifndef IO_URING_QUEUE_H
+#define IO_URING_QUEUE_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Socket.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * IoUringQueue
+ *
+ * The io_uring backend behind a Socket opened with Socket::IoUring. A
+ * multishot receive stays posted against a ring of buffers we hand to the
+ * kernel up front, so datagrams land in those buffers without a system call
+ * per packet and can be parsed right where they landed. Sends are queued as
+ * one submission entry each and go out with a single io_uring_enter().
+ *
+ * Only built on Linux with the BUILD_WITH_IO_URING option; Start() fails
+ * everywhere else, and on kernels too old for multishot receives, in which
+ * case the Socket carries on with ordinary system calls.
+ */
+class NETCORE_EXPORT IoUringQueue
+{
+public:
+   IoUringQueue();
+   ~IoUringQueue();
+
+   // coalesced: the socket has UDP_GRO on, so datagrams can be up to 64KB
+   // timestamped: the socket has SO_TIMESTAMPING on, so datagrams come with their arrival time
+   bool Start(int socket, bool coalesced, bool timestamped);
+   void Stop();
+   bool IsRunning() const { return mRing >= 0; }
+
+   int GetDescriptor() const { return mRing; } // readable whenever completions are waiting
+   bool HasCompletions() const; // true if Receive() has something to hand out right now
+
+   int Send(const Socket::Datagram datagrams[], int count); // returns number of datagrams sent
+
+   /**
+    * Hands out up to count received datagrams without copying them: mData
+    * points into the queue's own buffers, which stay valid until Release().
+    * Like Socket::ReceiveBatch(), a datagram that did not fit has mSize 0.
+    * @param wait True to block until at least one datagram has arrived
+    * @return The number of datagrams handed out
+    */
+   int Receive(Socket::Datagram datagrams[], int count, bool wait);
+   void Release(); // gives every buffer handed out by Receive() back to the kernel
+
+   unsigned int GetReceiveDrops() const { return mReceiveDrops; } // the kernel's running count, see Socket::GetReceiveDrops()
+   unsigned int GetSendDrops() const { return mSendDrops; } // sends refused for want of buffer space
+
+private:
+   void* NextEntry(); // a blank submission entry, NULL if the queue is full
+   bool Arm();
+   bool Submit(unsigned int minComplete); // submits the entries handed out, then waits for minComplete completions
+   void Reap();
+   void Recycle(unsigned short buffer);
+
+   int mRing;
+   int mSocket;
+
+   // the shared submission and completion rings
+   void* mRingMemory;
+   size_t mRingMemorySize;
+   void* mEntries; // submission queue entries
+   size_t mEntriesSize;
+   unsigned int* mSubmitHead;
+   unsigned int* mSubmitTail;
+   unsigned int mSubmitMask;
+   unsigned int mQueued; // entries filled in but not yet submitted
+   unsigned int* mCompleteHead;
+   unsigned int* mCompleteTail;
+   unsigned int mCompleteMask;
+   void* mCompletions;
+
+   // the provided buffers receives land in
+   void* mBufferRing;
+   unsigned char* mBuffers;
+   unsigned int mBufferCount;
+   unsigned int mBufferSize;
+   unsigned short mBufferTail;
+
+   void* mReceiveHeader; // msghdr telling the kernel how much address space to leave
+   bool mArmed; // the multishot receive is posted
+   bool mRefused; // the kernel turned the receive down as unsupported
+   int mSendsCompleted;
+   int mSendsSucceeded;
+   unsigned int mReceiveDrops;
+   unsigned int mSendDrops;
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<unsigned short> mReceived; // buffers reaped but not yet handed out
+   size_t mNextReceived;
+   std::vector<unsigned short> mHandedOut; // buffers waiting for Release()
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // IO_URING_QUEUE_H
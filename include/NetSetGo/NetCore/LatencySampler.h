@@ -0,0 +1,51 @@
+#ifndef LATENCY_SAMPLER_H
+#define LATENCY_SAMPLER_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * LatencySampler
+ *
+ * Keeps the most recent latencies measured, up to a fixed number of them, and
+ * reports percentiles over those. Adding a sample is cheap enough to do for
+ * every packet; the work is left to GetPercentile(), which sorts a copy.
+ */
+class NETCORE_EXPORT LatencySampler
+{
+public:
+   LatencySampler(int capacity = 4096);
+
+   void AddSample(double latency); // seconds; once full, replaces the oldest
+   void Reset();
+
+   int GetNumSamples() const { return static_cast<int>(mSamples.size()); }
+   int GetCapacity() const { return mCapacity; }
+   unsigned int GetNumAdded() const { return mNumAdded; } // since the last Reset(), held or not
+
+   // the latency that percentile percent of the samples held are no worse than,
+   // 0 if there are none; so 50 gives the median
+   double GetPercentile(float percentile) const;
+
+private:
+   int mCapacity;
+   unsigned int mNumAdded;
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<double> mSamples; // a ring once full, the oldest at mNumAdded % mCapacity
+   mutable std::vector<double> mSorted; // scratch for GetPercentile()
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // LATENCY_SAMPLER_H
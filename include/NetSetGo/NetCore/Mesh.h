@@ -1,15 +1,20 @@
 #ifndef MESH_H
 #define MESH_H
 
+#include <vector>
+
 #include <NetSetGo/NetCore/NetCoreExport.h>
 
 #include <NetSetGo/NetCore/Address.h>
 #include <NetSetGo/NetCore/PacketParser.h>
 
 #include <NetSetGo/NetCore/NetworkTopology.h>
+#include <NetSetGo/NetCore/TimerWheel.h>
 
 namespace net {
 
+class MeshTable;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // node mesh
@@ -22,15 +27,56 @@ namespace net {
  * This represents the network at large, and is only instantiated on the host or
  * server. Among other tasks, the Mesh regularly pings connected nodes to
  * confirm and maintain a stable network connection.
+ *
+ * A Mesh may also be one shard of a ShardedMesh, in which case it owns only
+ * the node IDs firstNodeID through firstNodeID + numNodes - 1, shares its port
+ * with the other shards, and takes the rest of the network from the table
+ * the shards share when informing its nodes of who else is connected.
+ *
+ * Informing every node of every other costs bytes in proportion to the square
+ * of their number. Given a multicast group, the mesh publishes who is
+ * connected to the group once per send instead, and sends each node only
+ * enough to keep its reliability system going; nodes subscribe as they
+ * connect, and say in their keep alives what they last heard. A node that
+ * never hears the group, or stops hearing it, is sent the table directly as
+ * before. Each shard of a ShardedMesh wants a group of its own. Nodes take
+ * from the group only what comes from the address they reached the mesh at,
+ * which needs to be that of the interface the mesh sends to the group from.
+ *
+ * The table goes out whole, with node IDs in single bytes, as long as there
+ * are no more than 255 nodes and it fits in GetMaxPacketSize(). Otherwise the
+ * mesh pages it: node IDs go out as variable length integers, and each send
+ * carries the next page of the table, so a node learns of everyone over as
+ * many sends as there are pages. Nodes follow whichever the mesh uses.
+ *
+ * Either way, the table is versioned, each change to an entry making a new
+ * version, and between keyframes (the whole table, or a page of it, every
+ * so many sends) a node is sent only the entries that changed since the
+ * version it is known to have: that of the last of its packets to be acked.
+ * Once nothing changes, this is next to nothing.
  */
 class NETCORE_EXPORT Mesh : public NetworkTopology
 {
 public:
    Mesh(unsigned int protocolId, int maxNodes = 255, float sendRate = 0.25f, float timeout = 10.0f);
+   Mesh(unsigned int protocolId, MeshTable& table, NodeID firstNodeID, int numNodes, float sendRate = 0.25f, float timeout = 10.0f);
 
    unsigned int GetProtocolID() const { return mProtocolID; }
    void Stop();
    void Update(float deltaTime);
+   float GetTimeUntilNextDeadline() const;
+
+   void SetMulticastGroup(const Address& group); // a blank address for none
+   const Address& GetMulticastGroup() const { return mMulticastGroup; }
+   bool IsNodeOnMulticast(NodeID nodeID) const; // the node hears the table through the group
+
+   void SetPagedTable(bool pagedTable); // to page a table that would fit whole
+   bool UsesPagedTable() const;
+   int GetTablePageSize() const; // nodes per page
+   NodeID GetNextKeyframePage() const { return mNextKeyframePage < GetNumTableNodes() ? mNextKeyframePage : 0; } // the first node of the page nodes not on the group are sent next
+
+   unsigned int GetTableVersion() const { return mTableVersion; }
+   unsigned int GetNodeTableVersion(NodeID nodeID) const; // the version the node is known to have
 
    NodeID FindFirstUnreservedNode() const; // NODEID_INVALID means none found
    // todo: merge this into NetworkTopology::ConnectNode()
@@ -58,7 +104,45 @@ private:
       Mesh& mMesh;
    };
 
+   int GetNumTableNodes() const; // including those of the other shards
+   void WriteTable(unsigned char* ptr, NodeID firstNodeID, int numNodes) const; // 6 bytes of address per node
+   NodeID NextPage(NodeID& cursor, int numNodes, int& numPageNodes) const; // the first node of the page at cursor, which moves on past it
+
+   // for sending only what has changed
+   struct SentVersion
+   {
+      unsigned int mSequence; // of a packet sent to a node
+      unsigned int mVersion; // of the table it brought the node up to
+   };
+   void ResetTableVersions();
+   void UpdateTableVersions(); // notes the entries that changed since the last call
+   void ProcessTableAcks(NodeID nodeID);
+   void RecordTableVersion(NodeID nodeID, unsigned int sequence, unsigned int version);
+   unsigned int GetPageVersion(unsigned int baseVersion, NodeID firstNodeID, int numNodes) const; // what a page brings a node that has baseVersion up to
+   size_t WriteDelta(unsigned char* ptr, size_t size, unsigned int baseVersion, unsigned int& version) const; // returns bytes written
+
    const int kMaxNodes;
+   MeshTable* mTable; // shared with the other shards, NULL if not sharded
+   bool mPagedTable; // asked for, even if the table would fit whole
+   NodeID mNextPage; // the first node of the page to send the group next
+   NodeID mNextKeyframePage; // the first node of the page to send nodes on their own at the next keyframe
+   int mSendsUntilKeyframe;
+   unsigned int mTableVersion; // 0 until the first entry is set
+
+   TimerWheel mTimeouts; // per node held here, armed while it keeps alive
+
+   Address mMulticastGroup;
+   unsigned int mMulticastSequence; // of the last table published to the group
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<unsigned int> mMulticastAcks; // per node held here, the last sequence it heard, 0 for none
+   std::vector<Address> mSentTable; // the table as of mTableVersion
+   std::vector<unsigned int> mEntryVersions; // per entry, the version that last changed it, 0 if none has
+   std::vector<NodeID> mChangeLog; // a ring of the entry each recent version changed
+   std::vector<unsigned int> mAckedVersions; // per node held here, the version it is known to have
+   std::vector<SentVersion> mSentVersions; // per node held here, a ring of its recent packets, by sequence
+   std::vector<int> mExpiredTimeouts; // scratch for CheckForTimeouts()
+#pragma warning (pop)
 };
 
 ////////////////////////////////////////////////////////////////////////////////
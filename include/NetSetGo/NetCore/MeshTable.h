@@ -0,0 +1,47 @@
+#ifndef MESH_TABLE_H
+#define MESH_TABLE_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Address.h>
+#include <NetSetGo/NetCore/NodeID.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * MeshTable
+ *
+ * The address of every node in the mesh, indexed by node ID. This is the one
+ * thing the shards of a ShardedMesh share: each shard writes the entries for
+ * the nodes it owns and reads all of them to build its update packets. Every
+ * entry is read and written atomically, so shards may be updated on different
+ * threads without any locking.
+ */
+class NETCORE_EXPORT MeshTable
+{
+public:
+   MeshTable(int numNodes);
+   ~MeshTable();
+
+   int GetNumNodes() const { return mNumNodes; }
+
+   void SetAddress(NodeID nodeID, const Address& address);
+   Address GetAddress(NodeID nodeID) const;
+
+private:
+   MeshTable(const MeshTable&); // not copyable
+   MeshTable& operator=(const MeshTable&);
+
+   const int mNumNodes;
+   unsigned long long* mEntries; // address in the upper bits, port in the lower 16
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // MESH_TABLE_H
@@ -7,9 +7,11 @@
 
 #include <NetSetGo/NetCore/Address.h>
 #include <NetSetGo/NetCore/Beacon.h>
+#include <NetSetGo/NetCore/LatencySampler.h>
 #include <NetSetGo/NetCore/Node.h>
 #include <NetSetGo/NetCore/Mesh.h>
 #include <NetSetGo/NetCore/PacketProcessor.h>
+#include <NetSetGo/NetCore/Poller.h>
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -26,6 +28,43 @@ namespace net {
    class NETCORE_EXPORT NetworkEngine
    {
    public:
+      /**
+       * LowLatencyProfile
+       *
+       * Trades CPU for latency, for hosts with cores to spare: the kernel busy
+       * polls the device for our sockets rather than waiting on an interrupt,
+       * the thread calling Update() stays on one core (and its cache), and
+       * WaitForWork() spins checking for packets before it goes to sleep.
+       */
+      struct LowLatencyProfile
+      {
+         int mBusyPollTime; // microseconds the kernel may poll per receive (SO_BUSY_POLL), 0 for none
+         int mCpu; // the core to pin the thread calling Update() to, negative for none
+         float mSpinTime; // seconds WaitForWork() spins before sleeping, 0 for none
+
+         LowLatencyProfile();
+      };
+
+      /**
+       * LowLatencyReport
+       *
+       * What the profile actually got: the kernel or the scheduler may turn
+       * down what it asks for, and whether the rest helps depends on the
+       * hardware, so compare the dispatch latencies with and without it.
+       * Dispatch latency is from a packet arriving on this host (as stamped
+       * by the kernel) to its reaching the packet parser.
+       */
+      struct LowLatencyReport
+      {
+         bool mBusyPolling; // the node's or mesh's socket is busy polling
+         bool mPinned; // the thread calling Update() is pinned
+         unsigned int mSpinWakeups; // WaitForWork() calls that found packets while spinning
+         unsigned int mSleepWakeups; // and those that went to sleep
+         int mNumSamples; // dispatch latencies the percentiles are over
+         double mDispatchLatency50; // seconds
+         double mDispatchLatency99;
+      };
+
       static NetworkEngine& GetRef();
       static void Destroy();
 
@@ -52,6 +91,28 @@ namespace net {
 
       void Update(float deltaTime);
 
+      /**
+       * Sleeps until a packet arrives on any of our sockets or until Update()
+       * next has a send or timeout due, whichever comes first. This lets a
+       * dedicated server call WaitForWork() and then Update() in a loop
+       * without spinning when the network is idle.
+       *
+       * @param maxWait The longest time to sleep, in seconds; negative means no limit
+       * @return True iff a packet is waiting to be received
+       */
+      bool WaitForWork(float maxWait);
+
+      /**
+       * Turns on the low latency profile. Busy polling takes effect as the
+       * node and mesh are next started, and pinning on the next Update();
+       * dispatch latencies are measured from now on.
+       */
+      void SetLowLatencyProfile(const LowLatencyProfile& profile);
+      void ClearLowLatencyProfile(); // the thread stays pinned, if it was
+      bool UsesLowLatencyProfile() const { return mLowLatency; }
+      const LowLatencyProfile& GetLowLatencyProfile() const { return mLowLatencyProfile; }
+      LowLatencyReport GetLowLatencyReport() const;
+
    protected:
       NetworkEngine();
       ~NetworkEngine();
@@ -72,6 +133,19 @@ namespace net {
 
       // for packet handling
       PacketProcessor mPacketProcessor;
+
+      // for sleeping between updates
+      Poller mPoller;
+
+      // for the low latency profile
+      bool PinThread(int cpu); // the calling one
+      bool mLowLatency;
+      LowLatencyProfile mLowLatencyProfile;
+      bool mPinTried; // pinning is only tried once per profile
+      bool mPinned;
+      unsigned int mSpinWakeups;
+      unsigned int mSleepWakeups;
+      LatencySampler mDispatchLatencies;
    };
 
 } // namespace net
@@ -3,14 +3,18 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
-#include <map>
+#include <vector>
 
 #include <NetSetGo/NetCore/NetCoreExport.h>
 #include <NetSetGo/NetCore/Socket.h>
+#include <NetSetGo/NetCore/Transport.h>
+#include <NetSetGo/NetCore/AddressMap.h>
 #include <NetSetGo/NetCore/ReliabilitySystem.h>
 #include <NetSetGo/NetCore/NodeID.h>
 #include <NetSetGo/NetCore/FlowControl.h>
 #include <NetSetGo/NetCore/GuaranteedDeliverySystem.h>
+#include <NetSetGo/NetCore/PacketPool.h>
+#include <NetSetGo/NetCore/LatencySampler.h>
 
 namespace net {
 
@@ -41,47 +45,87 @@ public:
       ConnectFail,
       Unknown = 0x7fffffff
    };
+   // what each node's tick looks at (its state, address and timeout) is
+   // held apart from this, in arrays of its own, so a pass over every node
+   // only reads what it needs; a NodeState holds the rest, which matters
+   // only once the node is connected
    struct NodeState
    {
-      // common
-      Address mAddress;
-      State mPreviousState, mCurrentState;
       // for reliability and flow control
       ReliabilitySystem mReliabilitySystem; // reliability system: manages sequence numbers and acks, tracks network stats etc.
       net::FlowControl mFlowControl;
       GuaranteedDeliverySystem mGuaranteedDeliverySystem;
       float mTransmissionDelayAccumulator;
 
-      // used only by Mesh (server)
-      float mTimeoutAccumulator;
-      bool mReserved;
-
       NodeState();
-      void Reset(bool resetState = true);
-      void Update(float deltaTime);
+      void Reset();
+      void Update(float deltaTime); // while connected
+
+   private:
+      NodeState(const NodeState&); // not copyable; mGuaranteedDeliverySystem refers to mReliabilitySystem
+      NodeState& operator=(const NodeState&);
    };
 
    // recommended timeout: 2 on a node, 10 on a server
    NetworkTopology(unsigned int protocolId, PacketParser* packetParser, float sendRate = 0.25f, float timeout = 10.0f, int maxPacketSize = 1024, unsigned int max_sequence = 0xFFFFFFFF);
-   ~NetworkTopology();
+   virtual ~NetworkTopology();
 
-   void SetMaxPacketSize(int maxPacketSize) { mMaxPacketSize = maxPacketSize; }
+   void SetMaxPacketSize(int maxPacketSize); // only while no received packets are held
    int GetMaxPacketSize() const { return mMaxPacketSize; }
    int GetMaxGuaranteedPacketPayloadSize() const;
 
    void SetTimeout(float timeout) { mTimeout = timeout; }
    float GetTimeout() const { return mTimeout; }
 
+   // when batching, packets handed to SendPacket() are held until the next
+   // Update() and then sent together, so a burst to one peer goes out as a
+   // single segmented send (see Socket::SendSegments())
+   void SetBatchSends(bool batchSends) { mBatchSends = batchSends; }
+   bool GetBatchSends() const { return mBatchSends; }
+
+   // datagrams go through our own socket unless given another transport to
+   // use instead (NULL to go back to the socket); it is opened on Start() and
+   // closed on Stop() just the same, but is not ours to delete
+   void SetTransport(Transport* transport);
+   const Transport& GetTransport() const { return *mTransport; }
+
+   // when connecting peers, each peer named by ConnectPeer() gets a socket of
+   // its own, connected to it and sharing our port, so that sends to it skip
+   // the route lookup and the kernel hands its datagrams straight to that
+   // socket; meant for a Node, which only talks to the mesh and a few others
+   void SetConnectPeers(bool connectPeers) { mConnectPeers = connectPeers; } // before Start(), on a given port
+   bool GetConnectPeers() const { return mConnectPeers; }
+
    bool Start(int port);
    virtual void Stop();
    bool IsRunning() const { return mRunning; }
    virtual void Update(float deltaTime); // don't forget to have descendents call ancestral method!
 
+   // for event-driven loops that sleep between updates (see NetworkEngine::WaitForWork())
+   const Socket& GetSocket() const { return mSocket; } // also counts the datagrams dropped on this host
+   void SetSocketBufferSizes(int receiveSize, int sendSize) { mSocket.SetBufferSizes(receiveSize, sendSize); } // before Start()
+   void SetBusyPoll(int microseconds); // on our socket and the peer sockets, 0 for none; takes effect on the next Start()
+   void GetSockets(std::vector<const Socket*>& sockets) const; // adds GetSocket(), every open peer socket and the multicast socket
+   virtual float GetTimeUntilNextDeadline() const; // seconds until Update() next has a send or timeout due
+
+   // when given a sampler (NULL to stop), every packet the kernel stamped adds
+   // how long it took from arriving on this host to reaching the packet parser;
+   // the sampler is not ours to delete, and may be shared with others
+   void SetDispatchLatencySampler(LatencySampler* sampler) { mDispatchLatencySampler = sampler; }
+   LatencySampler* GetDispatchLatencySampler() const { return mDispatchLatencySampler; }
+
    // note: this will fail if you try to give it a non-multicast address
    bool MulticastPacket(const net::Address& destination, const unsigned char data[], int size); // send data out via multi-cast
 
+   // hears a multicast group on a socket of its own, bound to the group's port
+   // and shared with anyone else on this host listening there; what arrives
+   // has no reliability header, and goes to ReceiveMulticastPacket() as it is
+   bool SubscribeMulticast(const net::Address& group); // while running; replaces any earlier group
+   void UnsubscribeMulticast();
+   const net::Address& GetMulticastSubscription() const { return mMulticastGroup; } // a blank address if none
+
    // node connectivity
-   State GetNodeCurrentState(NodeID nodeID) const { return mNodes[nodeID]->mCurrentState; }
+   State GetNodeCurrentState(NodeID nodeID) const { return mCurrentStates[nodeID - mFirstNodeID]; }
    bool WasNodeConnected(NodeID nodeID) const;
    bool IsNodeConnected(NodeID nodeID) const;
    bool NodeJustConnected(NodeID nodeID) const { return !WasNodeConnected(nodeID) && IsNodeConnected(nodeID); }
@@ -94,8 +138,14 @@ public:
    NodeState* GetNodeByID(NodeID nodeID);
    const NodeState* GetNodeByID(NodeID nodeID) const;
    const std::vector<NodeState*>& GetAllNodes() const;
+   // the nodes connecting or connected (and, until the next Update(), those
+   // that have just disconnected), without looking at the rest
+   NodeID GetFirstActiveNode() const; // NODEID_INVALID if none
+   NodeID GetNextActiveNode(NodeID nodeID) const; // NODEID_INVALID after the last
+   int GetNumActiveNodes() const { return mNumActiveNodes; }
+   NodeID FindFirstFreeNode() const; // the lowest disconnected one, NODEID_INVALID if none
    //
-   void Reserve(int numNodes);
+   void Reserve(int numNodes); // the NodeStates are made afresh if the number changes
 
    /// can include nodes that have dropped out
    inline int GetNumNodesReserved() const
@@ -103,18 +153,55 @@ public:
       return static_cast<int>(mNodes.size());
    };
 
+   // the nodes held here are numbered from this on (non-zero for a Mesh shard)
+   NodeID GetFirstNodeID() const { return mFirstNodeID; }
+
    // pure virtual methods
    virtual std::string GetIdentity() const = 0;
 
 protected:
    bool SendPacket(const net::Address& destination, ReliabilitySystem& reliabilitySystem, const unsigned char data[], int size);
+   // queued packets go out together on the next FlushPackets(), with runs to the
+   // same destination segmented by the kernel where possible; note that the
+   // reliability system counts a queued packet as sent straight away, so one
+   // the socket then fails to send is simply treated as lost
+   bool QueuePacket(const net::Address& destination, ReliabilitySystem& reliabilitySystem, const unsigned char data[], int size);
+   int FlushPackets(); // returns number of packets sent
    size_t WriteHeader(unsigned char* header, unsigned int sequence, unsigned int ack, unsigned int ack_bits);
    size_t ReadHeader(const unsigned char* header, unsigned int& sequence, unsigned int& ack, unsigned int& ack_bits);
+   // returns header size, 0 if rejected; time is when the packet arrived (Socket::GetTime()), 0 meaning just now
+   size_t ProcessHeader(const net::Address& origin, const unsigned char packet[], size_t size, double time = 0.0);
+   // note: should the kernel have coalesced the packet with others from the same
+   // sender, those others go to the packet parser, as they would in ReceivePackets()
    int ReceivePacket(net::Address& origin, unsigned char data[], int size);
    void ReceivePackets();
+   void ParseSegments(const Transport::Datagram& datagram, int offset); // parses each packet of a datagram from offset on
+   void ConnectPeer(const net::Address& address); // does nothing unless connecting peers
+   void DisconnectPeer(const net::Address& address);
+   void DisconnectPeers();
    void ClearData();
 
    virtual ReliabilitySystem* ChooseReliabilitySystem(const net::Address& nodeAddress);
+   virtual void ReceiveMulticastPacket(const net::Address& sender, const unsigned char data[], int size); // ignores it
+
+   void SetFirstNodeID(NodeID firstNodeID) { mFirstNodeID = firstNodeID; }
+   void AddSocketOptions(int options) { mSocket.SetOptions(mSocket.GetOptions() | options); } // before Start()
+
+   // received packets land in these buffers, each big enough for a header and
+   // the max packet size; a parser may keep a packet by sharing its buffer.
+   // Only a plain socket receives into them, though: with io_uring or receive
+   // offload (both on by default for the main socket) packets are parsed
+   // where the kernel left them, and one kept is copied into a pooled buffer
+   // instead, so zero copy receives are had only on the peer sockets, which
+   // use neither
+   PacketPool& GetPacketPool() { return mPacketPool; }
+
+   // per node bookkeeping, for the subclasses
+   void SetNodeCurrentState(NodeID nodeID, State state);
+   void SetNodeAddress(NodeID nodeID, const Address& address) { mAddresses[nodeID - mFirstNodeID] = address; }
+   bool IsNodeReserved(NodeID nodeID) const { return mReserved[nodeID - mFirstNodeID] != 0; } // used only by Mesh (server)
+   void SetNodeReserved(NodeID nodeID, bool reserved) { mReserved[nodeID - mFirstNodeID] = reserved ? 1 : 0; }
+   void ResetNode(NodeID nodeID, bool resetState = true);
 
    const unsigned int mProtocolID;
    float mSendRate;
@@ -127,24 +214,70 @@ protected:
 
    //*
    // todo: move down to private
-   typedef std::map<Address, NodeID> AddrToNodeID;
-   AddrToNodeID mAddrToNodeID;
+   AddressMap mAddrToNodeID;
    //*/
 
 private:
+   Transport& ChooseTransport(const net::Address& destination); // the peer's own socket, if it has an open one
+   void ReceivePackets(Transport& transport);
+   void ReceiveMulticastPackets();
+   void OpenPeerSocket(size_t index);
+   void LinkActiveNode(int index);
+   void UnlinkActiveNode(int index);
+
    bool mRunning;
 
    Socket mSocket;
+   Transport* mTransport; // mSocket, unless told otherwise
    static const int kHeaderSize;
    int mMaxPacketSize;
    PacketParser* mPacketParser;
+   bool mBatchSends;
+   bool mConnectPeers;
+   NodeID mFirstNodeID;
 
    /*
    // moved down to private
-   typedef std::map<Address, NodeID> AddrToNodeID;
-   AddrToNodeID mAddrToNodeID;
+   AddressMap mAddrToNodeID;
    //*/
-   std::vector<NodeState*> mNodes;
+   std::vector<NodeState*> mNodes; // into mNodeStates
+   NodeState* mNodeStates; // one block of them, in node order
+
+   // per node, in node order
+   std::vector<State> mPreviousStates;
+   std::vector<State> mCurrentStates;
+   std::vector<Address> mAddresses;
+   std::vector<unsigned char> mReserved;
+
+   // which nodes are active, linked through their indices in the order they
+   // became so (-1 ends the list, -2 marks a node not on it), and which are
+   // free, a bit each
+   std::vector<int> mNextActiveNodes;
+   std::vector<int> mPrevActiveNodes;
+   int mFirstActiveNode;
+   int mLastActiveNode;
+   int mNumActiveNodes;
+   std::vector<unsigned int> mFreeNodes;
+
+   // for batched sending and receiving
+   std::vector<unsigned char> mSendBuffer;
+   std::vector<size_t> mSendOffsets; // offset of each queued packet in mSendBuffer
+   std::vector<unsigned int> mSendSequences; // and its sequence number, to stamp it with when it really went out
+   std::vector<Transport::Datagram> mSendBatch;
+   std::vector<unsigned char> mReceiveBuffer; // for coalesced datagrams, too big for the pool, or any once it is spent
+   std::vector<Transport::Datagram> mReceiveBatch;
+   PacketPool mPacketPool;
+   std::vector<PacketPool::Handle> mReceiveHandles; // the pooled buffers of mReceiveBatch
+   LatencySampler* mDispatchLatencySampler;
+
+   // for connecting peers
+   std::vector<Address> mPeers;
+   std::vector<Socket*> mPeerSockets; // one per peer, open while we are running
+
+   // for hearing a multicast group
+   Socket mMulticastSocket;
+   Address mMulticastGroup;
+   std::vector<unsigned char> mMulticastBuffer;
 #pragma warning (pop)
 };
 
@@ -1,7 +1,7 @@
 #ifndef NODE_H
 #define NODE_H
 
-#include <queue>
+#include <vector>
 
 #include <NetSetGo/NetCore/NetCoreExport.h>
 
@@ -29,10 +29,21 @@ class NETCORE_EXPORT Node : public NetworkTopology
 public:
    static void PrintPacket(const unsigned char data[], int size);
 
+   /**
+    * BufferedPacket
+    *
+    * A packet from another node, waiting to be received. The payload stays
+    * in the pooled buffer it was received into, at mOffset, for as long as
+    * mBuffer holds on to it.
+    */
    struct BufferedPacket
    {
       NodeID mNodeId;
-      std::vector<unsigned char> mData;
+      PacketPool::Handle mBuffer;
+      int mOffset;
+      int mSize;
+
+      const unsigned char* GetData() const { return mBuffer.GetData() + mOffset; }
    };
 
    Node(unsigned int protocolId, float sendRate = 0.25f, float timeout = 2.0f, int maxPacketSize = 1024);
@@ -57,10 +68,12 @@ public:
    void SetLocalNodeID(NodeID localNodeID) { mLocalNodeID = localNodeID; }
 
    void Update(float deltaTime);
+   float GetTimeUntilNextDeadline() const;
 
    bool SendPacket(NodeID nodeID, const unsigned char data[], int size); // use this to send outgoing packets
    int ReceivePacket(NodeID& nodeID, unsigned char data[], int size); // remove stowed packet from buffer, write to data
-   void BufferPacket(NodeID nodeID, const unsigned char data[], int size); // copy incoming packet, stow into a buffer (used by PacketProcessor)
+   bool ReceivePacket(BufferedPacket& packet); // remove stowed packet from buffer without copying it; false if there is none
+   void BufferPacket(NodeID nodeID, const unsigned char data[], int size); // stow incoming packet, sharing its pooled buffer if it has one (used by PacketProcessor)
 
    unsigned int GetProtocolID() const { return mProtocolID; }
    const Address& GetMeshAddress() const { return mMeshAddress; }
@@ -77,8 +90,12 @@ protected:
 
    // overriding virtual methods
    ReliabilitySystem* ChooseReliabilitySystem(const net::Address& nodeAddress);
+   void ReceiveMulticastPacket(const net::Address& sender, const unsigned char data[], int size); // the mesh's table
 
 private:
+   void ReadTable(unsigned int version, bool whole, NodeID firstNodeID, int numNodes, const unsigned char table[]); // 6 bytes of address per node, as the mesh sends it
+   void ReadTableEntry(NodeID nodeID, const unsigned char entry[]);
+
    class NodePacketParser : public PacketParser
    {
    public:
@@ -95,8 +112,10 @@ private:
 #pragma warning (push)
 #pragma warning (disable:4251)
 
-   typedef std::queue<BufferedPacket*> PacketBuffer;
-   PacketBuffer mReceivedPackets;
+   // a ring, as big as the packet pool, so queueing never allocates
+   std::vector<BufferedPacket> mReceivedPackets;
+   size_t mFirstReceived;
+   size_t mNumReceived;
 
 #pragma warning (pop)
 
@@ -105,6 +124,8 @@ private:
    Address mMeshAddress;
    NodeID mLocalNodeID;
    ReliabilitySystem mMeshReliabilitySystem; // reliability system: manages sequence numbers and acks, tracks network stats etc.
+   unsigned int mMulticastSequence; // of the last table heard through the mesh's multicast group, 0 for none
+   unsigned int mTableVersion; // of the mesh's table, as far as we have it
 };
 
 ////////////////////////////////////////////////////////////////////////////////
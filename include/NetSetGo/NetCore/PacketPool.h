@@ -0,0 +1,88 @@
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * PacketPool
+ *
+ * A fixed set of equally sized packet buffers, allocated once up front. The
+ * socket receives straight into a buffer taken from the pool, and whoever
+ * wants to keep a packet around after it has been parsed (say, a Node queueing
+ * it for the application) holds on to a Handle rather than copying it out.
+ * The buffer goes back to the pool when its last Handle lets go.
+ *
+ * Not thread safe: a pool belongs to the one NetworkTopology that owns it.
+ */
+class NETCORE_EXPORT PacketPool
+{
+public:
+   /**
+    * Handle
+    *
+    * A reference counted claim on one buffer of the pool. Copying a Handle
+    * shares the buffer; an invalid Handle refers to nothing.
+    */
+   class NETCORE_EXPORT Handle
+   {
+   public:
+      Handle();
+      Handle(const Handle& other);
+      ~Handle();
+      Handle& operator=(const Handle& other);
+
+      bool IsValid() const { return mPool != NULL; }
+      unsigned char* GetData() const; // NULL if not valid
+      void Release(); // lets go of the buffer, leaving this Handle invalid
+
+   private:
+      friend class PacketPool;
+      Handle(PacketPool* pool, int buffer);
+
+      PacketPool* mPool;
+      int mBuffer;
+   };
+
+   PacketPool(int bufferSize, int numBuffers);
+   ~PacketPool();
+
+   int GetBufferSize() const { return mBufferSize; }
+   int GetNumBuffers() const { return static_cast<int>(mRefCounts.size()); }
+   int GetNumFree() const { return static_cast<int>(mFree.size()); }
+
+   // changes the size of every buffer; only allowed while none are in use
+   bool Resize(int bufferSize);
+
+   Handle Acquire(); // an unused buffer, or an invalid Handle if all are in use
+   Handle Share(const unsigned char* data); // the in-use buffer data points into, or an invalid Handle
+
+private:
+   PacketPool(const PacketPool&); // not copyable
+   PacketPool& operator=(const PacketPool&);
+
+   void AddRef(int buffer);
+   void Release(int buffer);
+
+   int mBufferSize;
+   unsigned char* mBuffers;
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<int> mRefCounts;
+   std::vector<int> mFree; // indices of the buffers nobody holds, used as a stack
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // PACKET_POOL_H
@@ -12,6 +12,11 @@ namespace net {
 // packet queue to store information about sent and received packets sorted in sequence order
 //  + we define ordering using the "sequence_more_recent" function, this works provided there is a large gap when sequence wrap occurs
 
+inline bool sequence_more_recent(unsigned int s1, unsigned int s2, unsigned int max_sequence)
+{
+   return ((s1 > s2) && (s1 - s2 <= max_sequence/2)) || ((s2 > s1) && (s2 - s1 > max_sequence/2));
+}
+
 /**
  * PacketData
  *
@@ -24,11 +29,12 @@ namespace net {
 struct NETCORE_EXPORT PacketData
 {
    unsigned int mSequence; // packet sequence number
-   float mTime;            // time offset since packet was sent or received (depending on context)
    int mSize;              // packet size in bytes
+   double mTime;           // when the packet was sent or received (depending on context), on the clock of whatever queued it
+   double mStamp;          // when the packet was sent or received, on the Socket::GetTime() clock (0 if not known)
 
    PacketData();
-   PacketData(unsigned int sequence, float time, int size);
+   PacketData(unsigned int sequence, double time, int size);
 
    bool operator==(const PacketData& packetData) const;
    bool operator<(const PacketData& packetData) const;
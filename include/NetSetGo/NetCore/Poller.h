@@ -0,0 +1,65 @@
+#ifndef POLLER__H
+#define POLLER__H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Socket.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Poller
+ *
+ * Puts the calling thread to sleep until at least one of a set of sockets has
+ * data waiting to be read, or until a timeout runs out. On Linux this is an
+ * epoll set with a timerfd for the timeout (so it is not rounded to whole
+ * milliseconds); elsewhere it falls back to select(). A socket using io_uring
+ * is waited on through its ring instead.
+ *
+ * The set of sockets is passed in on every call; only changes to the set cost
+ * anything, so it is fine to pass the same sockets over and over.
+ */
+class NETCORE_EXPORT Poller
+{
+public:
+   Poller();
+   ~Poller();
+
+   /**
+    * @param sockets The sockets to watch; closed sockets are ignored
+    * @param count The number of sockets
+    * @param timeout The longest time to wait in seconds; negative waits indefinitely
+    * @return True iff at least one of the sockets has data waiting
+    */
+   bool Wait(const Socket* const sockets[], int count, float timeout);
+
+private:
+   void Watch(const Socket* const sockets[], int count);
+   static Socket::SocketExternalType GetDescriptor(const Socket& socket); // what to wait on for this socket
+
+   struct Registration
+   {
+      int mDescriptor;
+      unsigned int mSerial; // tells a reopened socket apart from the one it replaced
+   };
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<Registration> mRegistrations;
+#pragma warning (pop)
+
+   int mEpoll;
+   int mTimer;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // POLLER__H
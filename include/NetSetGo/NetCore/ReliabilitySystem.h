@@ -8,13 +8,15 @@
 #include <NetSetGo/NetCore/NetCoreExport.h>
 
 #include <NetSetGo/NetCore/PacketQueue.h>
+#include <NetSetGo/NetCore/SequenceBuffer.h>
+#include <NetSetGo/NetCore/SlidingWindow.h>
 
 namespace net {
 
 ////////////////////////////////////////////////////////////////////////////////
 
 // reliability system to support reliable connection
-//  + manages sent, received, pending ack and acked packet queues
+//  + manages sent, pending ack and acked packet queues, and the received history
 //  + separated out from reliable connection because it is quite complex and I
 //    want to unit test it!
 
@@ -37,35 +39,47 @@ public:
    ReliabilitySystem(unsigned int max_sequence = 0xFFFFFFFF);
 
    void Reset();
-   void PacketSent(int size);
+   // times are on the Socket::GetTime() clock; given them for the packets
+   // sent and the acks received, the round trip time is measured from send
+   // to ack rather than in whole updates
+   void PacketSent(int size, double time = 0.0);
    void PacketReceived(unsigned int sequence, int size);
+   void StampSent(unsigned int sequence, double time); // corrects the send time of a packet that went out later than PacketSent()
+   void PacketDropped(); // the packet never left this host, the socket having no room for it
    unsigned int GenerateAckBits();
-   void ProcessAck(unsigned int ack, unsigned int ack_bits);
+   void ProcessAck(unsigned int ack, unsigned int ack_bits, double time = 0.0);
    void Update(float deltaTime);
    bool Validate() const;
 
    // utility functions
    static bool sequence_more_recent(unsigned int s1, unsigned int s2, unsigned int max_sequence);
    static int bit_index_for_sequence(unsigned int sequence, unsigned int ack, unsigned int max_sequence);
-   static unsigned int generate_ack_bits(unsigned int ack, const PacketQueue& received_queue, unsigned int max_sequence);
    static void process_ack(unsigned int ack, unsigned int ack_bits,
-                      PacketQueue& pending_ack_queue, PacketQueue& acked_queue,
+                      SequenceBuffer& pending_ack_queue, SequenceBuffer& acked_queue,
                       std::vector<unsigned int>& acks, unsigned int& acked_packets,
-                      float& rtt, unsigned int max_sequence);
+                      float& rtt, unsigned int max_sequence, double clock, double time = 0.0,
+                      PacketQueue* evicted_acked = NULL);
 
    // data accessors
    unsigned int GetLocalSequence() const { return mLocalSequence; } // note: this is the sequence number for the NEXT packet to be sent
    unsigned int GetRemoteSequence() const { return mRemoteSequence; }
    unsigned int GetMaxSequence() const { return mMaxSequence; }
 
-   //void GetAcks(unsigned int** acks, int& count);
+   const std::vector<unsigned int>& GetAcks() const { return mAcks; } // packets acked since the last Update(), as they are
 
    unsigned int GetSentPackets() const { return mSentPackets; }
    unsigned int GetReceivedPackets() const { return mRecvPackets; }
    unsigned int GetLostPackets() const { return mLostPackets; }
    unsigned int GetAckedPackets() const { return acked_packets; }
+   unsigned int GetDroppedPackets() const { return mDroppedPackets; } // dropped on this host, not lost on the network
+   // over the last second, bandwidths in kbps; they are kept up as packets
+   // come and go, so are cheap to read every update
    float GetSentBandwidth() const { return mSentBandwidth; }
    float GetAckedBandwidth() const { return mAckedBandwidth; }
+   float GetReceivedBandwidth() const { return mReceivedBandwidth; }
+   float GetSentPacketsPerSecond() const { return mSentPacketsPerSecond; }
+   float GetReceivedPacketsPerSecond() const { return mReceivedPacketsPerSecond; }
+   float GetLossRate() const { return mLossRate; } // of the packets found to be acked or lost
    float GetRoundTripTime() const { return mRoundTripTime; }
    int GetHeaderSize() const { return 12; }
 
@@ -73,7 +87,6 @@ public:
    const PacketQueue& GetRecentlyLostPackets() const { return mRecentlyLostPackets; }
 
 protected:
-   void AdvanceQueueTime(float deltaTime);
    void UpdateQueues();
    void UpdateStats();
 
@@ -81,26 +94,49 @@ private:
    unsigned int mMaxSequence;        // maximum sequence value before wrap around (used to test sequence wrap at low # values)
    unsigned int mLocalSequence;      // local sequence number for most recently sent packet
    unsigned int mRemoteSequence;     // remote sequence number for most recently received packet
+   bool mReceivedAny;                // so mRemoteSequence means something
+   unsigned int mReceivedBits;       // bit n set if mRemoteSequence - 1 - n was received, so the ack bits as they are sent
 
    unsigned int mSentPackets;        // total number of packets sent
    unsigned int mRecvPackets;        // total number of packets received
    unsigned int mLostPackets;        // total number of packets lost
    unsigned int acked_packets;       // total number of packets acked
+   unsigned int mDroppedPackets;     // total number of packets our socket had no room to send
 
    float mSentBandwidth;             // approximate sent bandwidth over the last second
    float mAckedBandwidth;            // approximate acked bandwidth over the last second
+   float mReceivedBandwidth;         // approximate received bandwidth over the last second
+   float mSentPacketsPerSecond;
+   float mReceivedPacketsPerSecond;
+   float mLossRate;                  // lost over acked and lost, in the last second
    float mRoundTripTime;             // estimated round trip time
    float mRoundTripTimeMaximum;      // maximum expected round trip time (hard coded to one second for the moment)
+   double mClock;                    // the sum of the update times; the queued packets are stamped with it, and aged against it
 
 #pragma warning (push)
 #pragma warning (disable:4251)
    std::vector<unsigned int> mAcks;  // acked packets from last set of packet receives. cleared each update!
 #pragma warning (pop)
 
-   PacketQueue mSentQueue;           // sent packets used to calculate sent bandwidth (kept until rtt_maximum)
-   PacketQueue mPendingAckQueue;     // sent packets which have not been acked yet (kept until rtt_maximum * 2)
-   PacketQueue mReceivedQueue;       // received packets for determining acks to send (kept up to most recent recv sequence - 32)
-   PacketQueue mAckedQueue;          // acked packets (kept until rtt_maximum * 2)
+   // held in rings by sequence, which take no memory until packets are sent
+   // and are given it back on Reset(); they grow as far as the sends in their
+   // time need, at up to 4096 packets a second. Sending faster than that,
+   // the ones that can't wait out their time in them are pushed out early,
+   // and reported at the next update as though their time was up, so the
+   // pending ones as lost
+   SequenceBuffer mSentQueue;        // sent packets used to calculate sent bandwidth (kept until rtt_maximum)
+   SequenceBuffer mPendingAckQueue;  // sent packets which have not been acked yet (kept until rtt_maximum)
+   SequenceBuffer mAckedQueue;       // acked packets (kept until rtt_maximum * 2)
+   PacketQueue mEvictedAcked;        // pushed out of mAckedQueue since the last update
+   PacketQueue mEvictedPending;      // pushed out of mPendingAckQueue since the last update, so lost
+
+   // running totals for the stats
+   int mSentBytes;                   // in mSentQueue
+   SlidingWindow mAckedBytes;
+   SlidingWindow mAckedCount;
+   SlidingWindow mLostCount;
+   SlidingWindow mReceivedBytes;
+   SlidingWindow mReceivedCount;
 
    // queues for storing recent changes; they get cleared every update
    PacketQueue mRecentlyAckedPackets;
@@ -0,0 +1,122 @@
+#ifndef SEQUENCE_BUFFER_H
+#define SEQUENCE_BUFFER_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <cstddef>
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/PacketQueue.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * SequenceBuffer
+ *
+ * Packets kept in sequence order, like a PacketQueue, but in a ring where
+ * each packet has its own slot, found from how far its sequence number is
+ * from the oldest one held. Looking one up, adding one and taking one away are
+ * O(1), and walking them goes in sequence order, skipping the empty slots
+ * between them.
+ *
+ * The ring starts out with no slots, and doubles as the packets held spread
+ * further apart in sequence, up to the capacity, so it only takes the memory
+ * the rate packets go through it needs. Once grown, it never allocates again
+ * until release().
+ *
+ * The packets held can be no more than the capacity apart in sequence; adding
+ * a newer one pushes out the oldest until it fits, and one older than that can
+ * not be added at all. Either way, insert() hands what didn't fit to the
+ * caller, to treat as having gone out of the window early.
+ */
+class NETCORE_EXPORT SequenceBuffer
+{
+public:
+   SequenceBuffer(int capacity, unsigned int max_sequence = 0xFFFFFFFF); // capacity is rounded up to a power of 2
+
+   /**
+    * iterator
+    *
+    * Walks the packets held, oldest first. Only erase(iterator) may be used
+    * on the buffer while walking it.
+    */
+   class NETCORE_EXPORT iterator
+   {
+   public:
+      iterator() : mBuffer(NULL), mOffset(0) {}
+
+      PacketData& operator*() const { return mBuffer->mEntries[mBuffer->GetSlot(mOffset)]; }
+      PacketData* operator->() const { return &**this; }
+      iterator& operator++();
+      bool operator==(const iterator& other) const { return mOffset == other.mOffset; }
+      bool operator!=(const iterator& other) const { return mOffset != other.mOffset; }
+
+   private:
+      friend class SequenceBuffer;
+      iterator(SequenceBuffer* buffer, unsigned int offset) : mBuffer(buffer), mOffset(offset) {}
+
+      SequenceBuffer* mBuffer;
+      unsigned int mOffset; // of its sequence from the oldest held
+   };
+
+   iterator begin() { return iterator(this, 0); }
+   iterator end() { return iterator(this, mSpan); }
+
+   void clear(); // keeps the slots grown so far
+   void release(); // clears, and gives back the slots
+   bool empty() const { return mSize == 0; }
+   int size() const { return mSize; }
+   int capacity() const { return int(mCapacity); }
+   int slots() const { return int(mEntries.size()); } // grown so far, up to the capacity
+   unsigned int max_sequence() const { return mMaxSequence; }
+
+   bool exists(unsigned int sequence) const { return find(sequence) != NULL; }
+   PacketData* find(unsigned int sequence);
+   const PacketData* find(unsigned int sequence) const;
+
+   // the packet must not be held already; what is pushed out, or p itself if
+   // it is too old, goes on the back of evicted if given
+   void insert(const PacketData& p, PacketQueue* evicted = NULL);
+   bool erase(unsigned int sequence);
+   iterator erase(iterator itor); // returns the one after it
+
+   PacketData& front() { return mEntries[mFirstSlot]; }
+   PacketData& back() { return mEntries[GetSlot(mSpan - 1)]; }
+   const PacketData& front() const { return mEntries[mFirstSlot]; }
+   const PacketData& back() const { return mEntries[GetSlot(mSpan - 1)]; }
+   void pop_front();
+
+   bool verify_sorted() const;
+
+private:
+   friend class iterator;
+
+   unsigned int GetDistance(unsigned int from, unsigned int to) const; // wrapping at mMaxSequence
+   unsigned int GetOffset(unsigned int sequence) const { return mSpan ? GetDistance(mEntries[mFirstSlot].mSequence, sequence) : ~0u; }
+   int GetSlot(unsigned int offset) const { return int((mFirstSlot + offset) & mMask); }
+   void Grow(unsigned int span); // to slots enough for packets span apart, as far as the capacity
+   void Trim(); // drops the empty slots at either end
+
+   unsigned int mMaxSequence;
+   unsigned int mCapacity;
+   unsigned int mMask; // of the slots grown so far
+   unsigned int mFirstSlot; // of the oldest held
+   unsigned int mSpan; // in sequence, from the oldest held to the newest, 0 when empty
+   int mSize;
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<PacketData> mEntries;
+   std::vector<unsigned char> mValid; // per slot, that it holds a packet
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // SEQUENCE_BUFFER_H
@@ -72,6 +72,40 @@ inline size_t ReadInteger(const unsigned char* data, unsigned int& value)
    return sizeof(int);
 }
 
+// variable length integers take seven bits to a byte, lowest first, with the
+// top bit set on every byte but the last; small values take a single byte
+
+static const size_t kMaxVarIntSize = 5;
+
+inline size_t WriteVarInt(unsigned char* data, unsigned int value)
+{
+   size_t size = 0;
+   while (value >= 0x80)
+   {
+      data[size++] = (unsigned char)((value & 0x7F) | 0x80);
+      value >>= 7;
+   }
+   data[size++] = (unsigned char)value;
+
+   return size;
+}
+
+// returns 0 if the value runs past size, or is too long to be one
+inline size_t ReadVarInt(const unsigned char* data, size_t size, unsigned int& value)
+{
+   value = 0;
+   for (size_t i = 0; i < size && i < kMaxVarIntSize; ++i)
+   {
+      value |= (unsigned int)(data[i] & 0x7F) << (7 * i);
+      if ((data[i] & 0x80) == 0)
+      {
+         return i + 1;
+      }
+   }
+
+   return 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 #endif // SERIALIZATION_H
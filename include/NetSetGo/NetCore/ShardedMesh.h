@@ -0,0 +1,62 @@
+#ifndef SHARDED_MESH_H
+#define SHARDED_MESH_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Mesh.h>
+#include <NetSetGo/NetCore/MeshTable.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * ShardedMesh
+ *
+ * A Mesh split across several sockets bound to the same port, so the work of
+ * a busy server can be spread over threads. The kernel hands each sender to
+ * one shard for good (SO_REUSEPORT), and each shard owns its own slice of the
+ * node IDs; the only thing the shards share is the MeshTable of addresses
+ * they tell their nodes about. A shard whose slice is full turns away new
+ * senders even while other shards have room, so leave some headroom.
+ *
+ * Either call Update() from one thread, or give each shard a thread of its
+ * own that calls GetShard(i).Update() - the shards touch nothing of each
+ * other's but the table. Linux only; Start() fails elsewhere.
+ */
+class NETCORE_EXPORT ShardedMesh
+{
+public:
+   ShardedMesh(unsigned int protocolId, int numShards, int maxNodes = 255, float sendRate = 0.25f, float timeout = 10.0f);
+   ~ShardedMesh();
+
+   bool Start(int port); // starts all the shards, or none of them
+   void Stop();
+   bool IsRunning() const;
+   void Update(float deltaTime);
+
+   int GetNumShards() const { return static_cast<int>(mShards.size()); }
+   Mesh& GetShard(int shard) { return *mShards[shard]; }
+   const Mesh& GetShard(int shard) const { return *mShards[shard]; }
+   const MeshTable& GetTable() const { return mTable; }
+
+private:
+   ShardedMesh(const ShardedMesh&); // not copyable
+   ShardedMesh& operator=(const ShardedMesh&);
+
+   MeshTable mTable;
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<Mesh*> mShards;
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // SHARDED_MESH_H
@@ -0,0 +1,93 @@
+#ifndef SHARED_MEMORY_TRANSPORT_H
+#define SHARED_MEMORY_TRANSPORT_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <map>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Transport.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * SharedMemoryTransport
+ *
+ * Carries datagrams between transports on the same host, be they in one
+ * process or several, with no system calls once under way. Opening one on a
+ * port creates a named shared memory inbox for that port: a ring of
+ * fixed-size slots that any number of senders claim with an atomic
+ * operation, and that only the owner reads. Datagrams are received in place,
+ * straight out of the ring.
+ *
+ * Ports are all there is to an address, so destinations are given as
+ * 127.0.0.1 and the port, and senders come back the same way. There is no
+ * broadcasting, and nothing to wake a sleeping receiver: a Poller only
+ * watches sockets, so whoever receives from one of these must keep polling
+ * it.
+ *
+ * POSIX only; Open() fails elsewhere.
+ */
+class NETCORE_EXPORT SharedMemoryTransport : public Transport
+{
+public:
+   // slotSize: the biggest datagram the inbox takes; numSlots: how many it holds at once (a power of two)
+   SharedMemoryTransport(int slotSize = 2048, int numSlots = 1024);
+   ~SharedMemoryTransport();
+
+   // implementations of pure virtual methods
+   bool Open(unsigned short port);
+   void Close();
+   bool IsOpen() const { return mInbox != NULL; }
+   unsigned short GetPort() const { return mPort; }
+   bool Send(const net::Address& destination, const void* data, int size);
+   int Receive(net::Address& sender, void* data, int size);
+
+   // overriding virtual methods
+   bool SendV(const net::Address& destination, const Buffer buffers[], int count); // writes the buffers straight into the slot
+   int ReceiveBatch(Datagram datagrams[], int count);
+   bool ReceivesInPlace() const { return IsOpen(); }
+   int ReceiveInPlace(Datagram datagrams[], int count);
+   void ReleaseReceived();
+   unsigned int GetReceiveDrops() const; // datagrams senders found no room for in our inbox
+   unsigned int GetSendDrops() const { return mSendDrops; } // datagrams we found no room for in theirs
+
+   int GetSlotSize() const { return mSlotSize; }
+   int GetNumSlots() const { return mNumSlots; }
+
+private:
+   SharedMemoryTransport(const SharedMemoryTransport&); // not copyable
+   SharedMemoryTransport& operator=(const SharedMemoryTransport&);
+
+   struct Region
+   {
+      void* mMemory; // starts with the ring's header, followed by its slots
+      size_t mSize;
+   };
+
+   void* GetOutbox(unsigned short port); // the inbox of whoever has that port open, NULL if nobody does
+   void DropOutbox(unsigned short port);
+
+   const int mSlotSize;
+   const int mNumSlots;
+   unsigned short mPort;
+   void* mInbox; // mapped shared memory, see Region
+   size_t mInboxSize;
+   unsigned long long mHead; // the next slot to be read
+   unsigned long long mReleased; // the next slot to be given back to senders
+   unsigned int mSendDrops;
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::map<unsigned short, Region> mOutboxes; // mapped on first send, kept until their owner closes
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // SHARED_MEMORY_TRANSPORT_H
@@ -0,0 +1,52 @@
+#ifndef SLIDING_WINDOW_H
+#define SLIDING_WINDOW_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * SlidingWindow
+ *
+ * A running total of what was added over the last so many seconds, kept in a
+ * fixed number of buckets of time. Adding to it, and moving time on, are O(1)
+ * (the latter per bucket passed), and the total is kept as buckets come and
+ * go rather than summed when asked for. What falls out of the window goes a
+ * whole bucket at a time, so the total covers between one bucket less than
+ * the window and the whole of it.
+ */
+class NETCORE_EXPORT SlidingWindow
+{
+public:
+   SlidingWindow(float duration = 1.0f, int numBuckets = 10); // duration in seconds
+
+   void Add(double value = 1.0);
+   void Advance(float deltaTime);
+   void Reset();
+
+   float GetDuration() const { return mBucketDuration * float(mBuckets.size()); }
+   double GetTotal() const { return mTotal; }
+   double GetRate() const { return mTotal / GetDuration(); } // per second
+
+private:
+   float mBucketDuration;
+   float mBucketTime; // spent in the current bucket so far
+   int mCurrent; // bucket being added to
+   double mTotal;
+#pragma warning (push)
+#pragma warning (disable:4251)
+   std::vector<double> mBuckets;
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // SLIDING_WINDOW_H
@@ -7,9 +7,12 @@
 
 #include <NetSetGo/NetCore/Address.h>
 #include <NetSetGo/NetCore/NetPlatform.h>
+#include <NetSetGo/NetCore/Transport.h>
 
 namespace net {
 
+class IoUringQueue;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 // socket functionality
@@ -29,26 +32,91 @@ void NETCORE_EXPORT ShutdownSockets();
  * An object-oriented wrapper for a low-level network socket. Note that this can
  * be used for broad-casting or multi-casting.
  */
-class NETCORE_EXPORT Socket
+class NETCORE_EXPORT Socket : public Transport
 {
 public:
    enum Options // | these together as desired
    {
       NonBlocking    = 1 << 0,
       Broadcast      = 1 << 1,
-      AllowMultiBind = 1 << 2
+      AllowMultiBind = 1 << 2,
+      IoUring        = 1 << 3, // use io_uring if built in and the kernel supports it
+      ReceiveOffload = 1 << 4, // let the kernel coalesce datagrams (UDP GRO), see Datagram::mSegmentSize
+      LoadBalance    = 1 << 5, // share the port with other such sockets, each sender sticking to one (Linux only)
+      Timestamps     = 1 << 6, // have the kernel stamp datagrams with when they arrived, see Datagram::mTime
+      AutoTuneBuffers = 1 << 7, // grow the kernel buffers whenever datagrams are dropped for want of room
+      BusyPoll       = 1 << 8 // have the kernel poll the device rather than sleep while receiving (Linux only), see SetBusyPollTime()
    };
 
    Socket(int options = NonBlocking);
    ~Socket();
 
-   bool Open(unsigned short port);
-   void Close();
-   bool IsOpen() const;
-   unsigned short GetPort() const { return mPort; }
+   virtual bool Open(unsigned short port);
+   virtual void Close();
+   virtual bool IsOpen() const;
+   virtual unsigned short GetPort() const { return mPort; }
+   void SetOptions(int options) { mOptions = options; } // takes effect on the next Open()
+   int GetOptions() const { return mOptions; }
+   virtual bool UsesReceiveOffload() const { return (mOptions & ReceiveOffload) != 0; } // false if the kernel turned it down
+   bool UsesTimestamps() const { return (mOptions & Timestamps) != 0; } // false if the kernel turned it down
+   bool UsesBusyPoll() const { return (mOptions & BusyPoll) != 0; } // false if the kernel turned it down
+   void SetBusyPollTime(int microseconds) { mBusyPollTime = microseconds; } // takes effect on the next Open()
+   int GetBusyPollTime() const { return mBusyPollTime; }
+
+   /**
+    * Ties the open socket to one peer: it then only receives from that peer,
+    * and sends to it without looking up the route each time. With
+    * AllowMultiBind, such a socket can share its port with an unconnected
+    * one, which goes on receiving from everybody else. Lasts until Close().
+    */
+   bool Connect(const net::Address& peer);
+   const net::Address& GetPeer() const { return mPeer; } // a blank address if not connected
+
+   static double GetTime(); // seconds, on the clock the kernel stamps datagrams with
+
+   /** buffer calls
+    * The kernel holds datagrams in a receive buffer until we read them, and
+    * in a send buffer until they go out; when either is full, datagrams are
+    * dropped on this host rather than lost on the network. Sizes are in bytes
+    * as the kernel reports them, 0 leaving the system default. With
+    * AutoTuneBuffers, a buffer is doubled (up to 8MB, and whatever limit the
+    * system sets) each time it is found to have overflowed.
+    */
+   void SetBufferSizes(int receiveSize, int sendSize); // takes effect on the next Open()
+   int GetReceiveBufferSize() const; // 0 if not open
+   int GetSendBufferSize() const;
+   virtual unsigned int GetReceiveDrops() const { return mReceiveDrops; } // datagrams the kernel had no room for (Linux only)
+   virtual unsigned int GetSendDrops() const { return mSendDrops; } // sends refused for want of buffer space
+
+   virtual bool Send(const net::Address& destination, const void* data, int size);
+   virtual int Receive(net::Address& sender, void* data, int size); // returns number of bytes read
+   // sends the buffers, one after the other, as a single datagram without first copying them together
+   virtual bool SendV(const net::Address& destination, const Buffer buffers[], int count);
+
+   // batched versions of the above; on Linux each is a single system call
+   virtual int SendBatch(const Datagram datagrams[], int count); // returns number of datagrams sent
+   virtual int ReceiveBatch(Datagram datagrams[], int count); // returns number of datagrams taken off the socket
+
+   /**
+    * Sends a run of datagrams to one destination, laid out back to back in a
+    * single buffer: every segment is segmentSize bytes except the last, which
+    * may be shorter. On Linux this is generic segmentation offload (UDP_SEGMENT)
+    * so the whole run costs one trip through the stack; elsewhere, or if the
+    * kernel turns it down, the segments go out one at a time.
+    * @return The number of segments sent
+    */
+   virtual int SendSegments(const net::Address& destination, const void* data, int size, int segmentSize);
 
-   bool Send(const net::Address& destination, const void* data, int size);
-   int Receive(net::Address& sender, void* data, int size); // returns number of bytes read
+   /** io_uring calls
+    * While UsesIoUring(), ReceiveInPlace() fills in datagrams pointing straight
+    * into the buffers the kernel received them into, rather than copying them
+    * out; these stay valid until ReleaseReceived(), which must be called before
+    * receiving in place again. The other calls go through io_uring as well.
+    */
+   bool UsesIoUring() const;
+   virtual bool ReceivesInPlace() const { return UsesIoUring(); }
+   virtual int ReceiveInPlace(Datagram datagrams[], int count); // returns number of datagrams handed out
+   virtual void ReleaseReceived();
 
    void ReportLastError();
 
@@ -66,6 +134,19 @@ public:
    bool Unsubscribe(const net::Address& multicastAddress);
 
 private:
+   friend class Poller; // waits on the low-level socket
+   friend class IoUringQueue; // reads control messages just as we do
+
+   // control messages (UDP_GRO segment sizes, timestamps) received with datagrams
+   // as well as kernel drop counts, which come with every datagram where supported
+   static int GetControlSize(bool coalesced, bool timestamped); // bytes needed for those asked for
+   static void ReadControl(void* header, Datagram& datagram, unsigned int& receiveDrops); // header is a msghdr
+
+   static bool OutOfBufferSpace(); // true if the last send failed for want of room, rather than for good
+   void DroppedSends(unsigned int count);
+   void DroppedReceives(unsigned int receiveDrops); // the kernel's running count
+   bool GrowBuffer(int option); // SO_RCVBUF or SO_SNDBUF
+
 #if NET_PLATFORM == NET_PLATFORM_WINDOWS
    typedef unsigned int* SocketExternalType;
 #else
@@ -75,6 +156,15 @@ private:
    SocketExternalType mSocket;
    int mOptions;
    unsigned short mPort;
+   unsigned int mSerial; // changes every time the socket is opened
+   IoUringQueue* mQueue; // non-NULL while io_uring is in use
+   net::Address mPeer; // as Connect()ed to
+   bool mSegmentOffload; // cleared if the kernel refuses UDP_SEGMENT
+   int mReceiveBufferSize; // as asked for, 0 for the default
+   int mSendBufferSize;
+   int mBusyPollTime; // microseconds
+   unsigned int mReceiveDrops;
+   unsigned int mSendDrops;
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,92 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <vector>
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * TimerWheel
+ *
+ * Deadlines for a fixed number of timers, numbered from 0, kept so that
+ * arming, re-arming or cancelling one takes the same short time however many
+ * there are, and moving time on only touches the timers that come due (and,
+ * now and then, those far enough off to be moved nearer). This is what to use
+ * for a deadline per connection, most of which are pushed back again and
+ * again and never reached.
+ *
+ * Time moves in ticks of a fixed resolution, and a timer is due on the first
+ * tick at or after its deadline. The wheel has four levels of 64 slots: the
+ * first holds the timers due in the next 64 ticks, one slot per tick, and
+ * each level after that holds 64 times as far ahead at 64 times the
+ * granularity, its timers moving down a level as their slot comes round.
+ * Anything further off than the last level reaches waits in its last slot.
+ */
+class NETCORE_EXPORT TimerWheel
+{
+public:
+   TimerWheel(float resolution = 1.0f / 64.0f, int numTimers = 0); // resolution in seconds
+   ~TimerWheel();
+
+   void Reserve(int numTimers); // cancels every timer
+   int GetNumTimers() const { return int(mDue.size()); }
+   float GetResolution() const { return mResolution; }
+
+   void Schedule(int timer, float delay); // seconds from now; re-arms a timer already scheduled
+   void Cancel(int timer);
+   void CancelAll();
+   bool IsScheduled(int timer) const { return mSlots[timer] != kNotScheduled; }
+   int GetNumScheduled() const { return mNumScheduled; }
+
+   // moves time on, appending the timers that came due to expired, soonest
+   // first; they are no longer scheduled
+   void Advance(float deltaTime, std::vector<int>& expired);
+   // never later than the next timer is due, but may be earlier; a very
+   // long time if none is scheduled
+   float GetTimeUntilNext() const;
+
+private:
+   enum
+   {
+      kNumLevels = 4,
+      kSlotBits = 6,
+      kNumSlots = 1 << kSlotBits,
+      kSlotMask = kNumSlots - 1,
+      kEnd = -1,
+      kNotScheduled = -1
+   };
+
+   TimerWheel(const TimerWheel&); // not copyable
+   TimerWheel& operator=(const TimerWheel&);
+
+   void Insert(int timer);
+   void Remove(int timer);
+   void Tick(std::vector<int>& expired);
+
+   float mResolution;
+   float mRemainder; // of the time moved on, less than a tick
+   unsigned long long mNow; // in ticks
+   int mNumScheduled;
+   int mHeads[kNumLevels * kNumSlots]; // the first timer in each slot
+
+#pragma warning (push)
+#pragma warning (disable:4251)
+   // per timer
+   std::vector<unsigned long long> mDue; // in ticks
+   std::vector<int> mSlots; // which it is in
+   std::vector<int> mNext; // in the same slot
+   std::vector<int> mPrev;
+#pragma warning (pop)
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // TIMER_WHEEL_H
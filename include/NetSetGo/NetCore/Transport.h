@@ -0,0 +1,113 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/NetCoreExport.h>
+
+#include <NetSetGo/NetCore/Address.h>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/**
+ * Transport
+ *
+ * Whatever carries datagrams from one port to another. Socket is the usual
+ * one, going through the kernel's UDP stack; SharedMemoryTransport carries
+ * them between processes on the same host without a system call. A
+ * NetworkTopology can be handed any of these (see
+ * NetworkTopology::SetTransport()).
+ *
+ * Only Open(), Close(), IsOpen(), GetPort(), Send() and Receive() must be
+ * implemented; the other calls are built out of those here, for transports
+ * with nothing better to offer.
+ */
+class NETCORE_EXPORT Transport
+{
+public:
+   /**
+    * Datagram
+    *
+    * One entry of a batched send or receive. When sending, mAddress is the
+    * destination and mData/mSize describe the bytes to go out. When receiving,
+    * mData/mSize describe the buffer to be filled; on return mAddress holds the
+    * sender and mSize the number of bytes read (0 if the datagram was dropped
+    * for not fitting in the buffer).
+    *
+    * A transport that UsesReceiveOffload() may hand back several datagrams
+    * from the same sender coalesced into one: mData then holds them back to
+    * back, each mSegmentSize bytes but for a possibly shorter last one. Buffers
+    * need room for 64KB to be sure of taking these in. mSegmentSize is equal to
+    * mSize for a datagram that was not coalesced, and is ignored when sending.
+    *
+    * mTime is when a received datagram arrived, on the Socket::GetTime()
+    * clock; it is 0 where that isn't known, and is ignored when sending.
+    */
+   struct Datagram
+   {
+      net::Address mAddress;
+      void* mData;
+      int mSize;
+      int mSegmentSize;
+      double mTime;
+   };
+
+   /**
+    * Buffer
+    *
+    * One piece of a datagram gathered from several places by SendV().
+    */
+   struct Buffer
+   {
+      const void* mData;
+      int mSize;
+   };
+
+   virtual ~Transport();
+
+   virtual bool Open(unsigned short port) = 0;
+   virtual void Close() = 0;
+   virtual bool IsOpen() const = 0;
+   virtual unsigned short GetPort() const = 0;
+
+   virtual bool Send(const net::Address& destination, const void* data, int size) = 0;
+   virtual int Receive(net::Address& sender, void* data, int size) = 0; // returns number of bytes read
+   // sends the buffers, one after the other, as a single datagram
+   virtual bool SendV(const net::Address& destination, const Buffer buffers[], int count);
+
+   // batched versions of the above
+   virtual int SendBatch(const Datagram datagrams[], int count); // returns number of datagrams sent
+   virtual int ReceiveBatch(Datagram datagrams[], int count); // returns number of datagrams taken off the transport
+
+   /**
+    * Sends a run of datagrams to one destination, laid out back to back in a
+    * single buffer: every segment is segmentSize bytes except the last, which
+    * may be shorter.
+    * @return The number of segments sent
+    */
+   virtual int SendSegments(const net::Address& destination, const void* data, int size, int segmentSize);
+
+   /** in place calls
+    * While ReceivesInPlace(), ReceiveInPlace() fills in datagrams pointing
+    * straight into the transport's own buffers rather than copying them out;
+    * these stay valid until ReleaseReceived(), which must be called before
+    * receiving in place again.
+    */
+   virtual bool ReceivesInPlace() const { return false; }
+   virtual int ReceiveInPlace(Datagram datagrams[], int count); // returns number of datagrams handed out
+   virtual void ReleaseReceived() {}
+
+   virtual bool UsesReceiveOffload() const { return false; } // see Datagram::mSegmentSize
+
+   // datagrams dropped on this host for want of room, where the transport can tell
+   virtual unsigned int GetReceiveDrops() const { return 0; }
+   virtual unsigned int GetSendDrops() const { return 0; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
+
+#endif // TRANSPORT_H
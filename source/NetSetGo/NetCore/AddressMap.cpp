@@ -0,0 +1,195 @@
+#include <NetSetGo/NetCore/AddressMap.h>
+
+#include <cassert>
+
+#include <NetSetGo/NetCore/Bits.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#   include <emmintrin.h>
+#   define NET_ADDRESS_MAP_SSE2 1 // a group's control bytes are matched in one go
+#else
+#   define NET_ADDRESS_MAP_SSE2 0
+#endif
+
+namespace net {
+
+   // control bytes; those of slots in use have the top bit clear
+   static const unsigned char kEmpty   = 0x80;
+   static const unsigned char kDeleted = 0xFE;
+
+   static const int kMinSlots = 16;
+
+////////////////////////////////////////////////////////////////////////////////
+
+   // a bit set for each of the group's 16 control bytes equal to value
+   static unsigned int MatchGroup(const unsigned char* group, unsigned char value)
+   {
+#if NET_ADDRESS_MAP_SSE2
+      const __m128i control = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+      return unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(control, _mm_set1_epi8(char(value)))));
+#else
+      unsigned int matches = 0;
+      for (int i = 0; i < 16; ++i)
+      {
+         matches |= (group[i] == value ? 1u : 0u) << i;
+      }
+      return matches;
+#endif
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   AddressMap::AddressMap()
+      : mSize(0)
+      , mNumDeleted(0)
+   {
+   }
+
+   unsigned long long AddressMap::Hash(unsigned long long key)
+   {
+      // the MurmurHash3 finalizer, so every bit of the address and port counts
+      key ^= key >> 33;
+      key *= 0xFF51AFD7ED558CCDULL;
+      key ^= key >> 33;
+      key *= 0xC4CEB9FE1A85EC53ULL;
+      key ^= key >> 33;
+      return key;
+   }
+
+   int AddressMap::FindSlot(unsigned long long key, unsigned long long hash) const
+   {
+      if (mControl.empty())
+      {
+         return -1;
+      }
+
+      // groups are probed one, two, three... groups on from the first, which
+      // visits every group when there are a power of two of them
+      const size_t groupMask = mControl.size() / kGroupSize - 1;
+      const unsigned char tag = (unsigned char)(hash & 0x7F);
+      size_t group = size_t(hash >> 7) & groupMask;
+      for (size_t step = 1; step <= groupMask + 1; ++step)
+      {
+         const size_t first = group * kGroupSize;
+         for (unsigned int matches = MatchGroup(&mControl[first], tag); matches != 0; matches &= matches - 1)
+         {
+            const size_t slot = first + LowestBit(matches);
+            if (mKeys[slot] == key)
+            {
+               return int(slot);
+            }
+         }
+         if (MatchGroup(&mControl[first], kEmpty) != 0)
+         {
+            return -1; // it would have gone in that empty slot
+         }
+         group = (group + step) & groupMask;
+      }
+      return -1;
+   }
+
+   NodeID AddressMap::Find(const Address& address) const
+   {
+      const unsigned long long key = Pack(address);
+      const int slot = FindSlot(key, Hash(key));
+      return slot >= 0 ? mValues[slot] : NodeID(NODEID_INVALID);
+   }
+
+   void AddressMap::Insert(const Address& address, NodeID nodeID)
+   {
+      const unsigned long long key = Pack(address);
+      const unsigned long long hash = Hash(key);
+      const int found = FindSlot(key, hash);
+      if (found >= 0)
+      {
+         mValues[found] = nodeID;
+         return;
+      }
+
+      // keep at least an eighth of the slots empty, so probes stay short
+      if ((mSize + mNumDeleted + 1) * 8 > GetCapacity() * 7)
+      {
+         Rehash((mSize + 1) * 2 > GetCapacity() ? GetCapacity() * 2 : GetCapacity());
+      }
+
+      const size_t groupMask = mControl.size() / kGroupSize - 1;
+      size_t group = size_t(hash >> 7) & groupMask;
+      for (size_t step = 1; ; ++step)
+      {
+         const size_t first = group * kGroupSize;
+         const unsigned int free = MatchGroup(&mControl[first], kEmpty) | MatchGroup(&mControl[first], kDeleted);
+         if (free != 0)
+         {
+            const size_t slot = first + LowestBit(free);
+            mNumDeleted -= mControl[slot] == kDeleted ? 1 : 0;
+            mControl[slot] = (unsigned char)(hash & 0x7F);
+            mKeys[slot] = key;
+            mValues[slot] = nodeID;
+            ++mSize;
+            return;
+         }
+         group = (group + step) & groupMask;
+      }
+   }
+
+   bool AddressMap::Erase(const Address& address)
+   {
+      const unsigned long long key = Pack(address);
+      const int slot = FindSlot(key, Hash(key));
+      if (slot < 0)
+      {
+         return false;
+      }
+
+      // a probe may have passed over this slot on its way further on, so it is
+      // only marked deleted; a group with an empty slot ends every probe, so
+      // there the slot can simply be emptied
+      const size_t first = size_t(slot) / kGroupSize * kGroupSize;
+      if (MatchGroup(&mControl[first], kEmpty) != 0)
+      {
+         mControl[slot] = kEmpty;
+      }
+      else
+      {
+         mControl[slot] = kDeleted;
+         ++mNumDeleted;
+      }
+      --mSize;
+      return true;
+   }
+
+   void AddressMap::Clear()
+   {
+      mControl.assign(mControl.size(), kEmpty);
+      mSize = 0;
+      mNumDeleted = 0;
+   }
+
+   void AddressMap::Rehash(int numSlots)
+   {
+      numSlots = numSlots < kMinSlots ? kMinSlots : numSlots;
+      assert(numSlots % kGroupSize == 0);
+      assert((numSlots & (numSlots - 1)) == 0);
+
+      std::vector<unsigned char> control(numSlots, kEmpty);
+      std::vector<unsigned long long> keys(numSlots);
+      std::vector<NodeID> values(numSlots);
+      control.swap(mControl);
+      keys.swap(mKeys);
+      values.swap(mValues);
+      mSize = 0;
+      mNumDeleted = 0;
+
+      for (size_t slot = 0; slot < control.size(); ++slot)
+      {
+         if ((control[slot] & 0x80) == 0)
+         {
+            const unsigned long long key = keys[slot];
+            Insert(Address((unsigned int)(key >> 16), (unsigned short)(key & 0xFFFF)), values[slot]);
+         }
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -172,6 +172,12 @@ namespace net {
       }
    }
 
+   float BeaconTransmitter::GetTimeUntilNextBeacon() const
+   {
+      const float timeUntilBeacon = mDelayBetweenBeacons - mTimeAccumulator;
+      return timeUntilBeacon > 0.0f ? timeUntilBeacon : 0.0f;
+   }
+
    bool BeaconTransmitter::SendBeacon()
    {
       bool success = true; // until proven otherwise
@@ -0,0 +1,218 @@
+#include <NetSetGo/NetCore/ImpairedTransport.h>
+#include <NetSetGo/NetCore/Socket.h>
+
+#include <cassert>
+#include <cstring>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   ImpairedTransport::Impairments::Impairments()
+      : mLatency(0.0f)
+      , mJitter(0.0f)
+      , mLoss(0.0f)
+      , mBurstStart(0.0f)
+      , mBurstEnd(0.0f)
+      , mBurstLoss(0.0f)
+      , mDuplication(0.0f)
+      , mReordering(0.0f)
+      , mReorderDelay(0.0f)
+      , mBandwidth(0)
+      , mQueueSize(0)
+   {
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   ImpairedTransport::ImpairedTransport(Transport& transport, const Impairments& impairments, unsigned int seed)
+      : mTransport(transport)
+      , mImpairments(impairments)
+      , mState(0)
+      , mTime(-1.0)
+      , mBursting(false)
+      , mLinkFree(0.0)
+      , mNumLost(0)
+      , mNumDuplicated(0)
+      , mNumReordered(0)
+   {
+      Seed(seed);
+   }
+
+   ImpairedTransport::~ImpairedTransport()
+   {
+   }
+
+   void ImpairedTransport::Seed(unsigned int seed)
+   {
+      // xorshift needs a state that isn't zero
+      mState = (unsigned long long)seed * 0x9E3779B97F4A7C15ULL + 1;
+   }
+
+   double ImpairedTransport::GetTime() const
+   {
+      return mTime >= 0.0 ? mTime : Socket::GetTime();
+   }
+
+   int ImpairedTransport::Flush()
+   {
+      int sent = 0;
+      const double now = GetTime();
+      while (!mPending.empty() && mPending.begin()->first <= now)
+      {
+         const Held& held = mPending.begin()->second;
+         const unsigned char* data = held.mData.empty() ? NULL : &held.mData[0]; // an empty one has no first byte to point at
+         if (mTransport.Send(held.mDestination, data, int(held.mData.size())))
+         {
+            ++sent;
+         }
+         mPending.erase(mPending.begin());
+      }
+      return sent;
+   }
+
+   bool ImpairedTransport::Open(unsigned short port)
+   {
+      mPending.clear();
+      mBursting = false;
+      mLinkFree = 0.0;
+      return mTransport.Open(port);
+   }
+
+   void ImpairedTransport::Close()
+   {
+      mPending.clear();
+      mTransport.Close();
+   }
+
+   bool ImpairedTransport::Send(const net::Address& destination, const void* data, int size)
+   {
+      Buffer buffer;
+      buffer.mData = data;
+      buffer.mSize = size;
+      return SendV(destination, &buffer, 1);
+   }
+
+   bool ImpairedTransport::SendV(const net::Address& destination, const Buffer buffers[], int count)
+   {
+      assert(buffers);
+      assert(count > 0);
+
+      if (!IsOpen())
+      {
+         return false;
+      }
+
+      Flush();
+      const double now = GetTime();
+
+      int size = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         size += buffers[i].mSize;
+      }
+
+      // the link may go bad, or come good again, before each datagram
+      if (mBursting ? Chance(mImpairments.mBurstEnd) : Chance(mImpairments.mBurstStart))
+      {
+         mBursting = !mBursting;
+      }
+
+      // datagrams wait their turn for the bandwidth, and are dropped once too
+      // many bytes are waiting, as a router would; what is lost at random
+      // still took up its share of the bandwidth
+      double departure = now;
+      if (mImpairments.mBandwidth > 0)
+      {
+         const double start = mLinkFree > now ? mLinkFree : now;
+         if (mImpairments.mQueueSize > 0 && (start - now) * mImpairments.mBandwidth > mImpairments.mQueueSize)
+         {
+            ++mNumLost;
+            return true;
+         }
+         departure = start + double(size) / mImpairments.mBandwidth;
+         mLinkFree = departure;
+      }
+
+      // a lost datagram was sent, as far as the sender can tell
+      if (Chance(mBursting ? mImpairments.mBurstLoss : mImpairments.mLoss))
+      {
+         ++mNumLost;
+         return true;
+      }
+
+      const bool duplicate = Chance(mImpairments.mDuplication);
+      if (duplicate)
+      {
+         ++mNumDuplicated;
+      }
+
+      bool sent = true;
+      for (int copy = 0; copy < (duplicate ? 2 : 1); ++copy)
+      {
+         double due = departure + mImpairments.mLatency + mImpairments.mJitter * Random();
+         if (Chance(mImpairments.mReordering))
+         {
+            due += mImpairments.mReorderDelay;
+            ++mNumReordered;
+         }
+
+         if (due <= now)
+         {
+            // nothing held is due yet, so this can go straight out
+            const bool copySent = mTransport.SendV(destination, buffers, count);
+            sent = copy == 0 ? copySent : sent;
+         }
+         else
+         {
+            std::multimap<double, Held>::iterator itor = mPending.insert(std::make_pair(due, Held()));
+            itor->second.mDestination = destination;
+            itor->second.mData.resize(size);
+            int offset = 0;
+            for (int i = 0; i < count; ++i)
+            {
+               if (buffers[i].mSize > 0)
+               {
+                  memcpy(&itor->second.mData[offset], buffers[i].mData, buffers[i].mSize);
+                  offset += buffers[i].mSize;
+               }
+            }
+         }
+      }
+
+      return sent;
+   }
+
+   int ImpairedTransport::Receive(net::Address& sender, void* data, int size)
+   {
+      Flush();
+      return mTransport.Receive(sender, data, size);
+   }
+
+   int ImpairedTransport::ReceiveBatch(Datagram datagrams[], int count)
+   {
+      Flush();
+      return mTransport.ReceiveBatch(datagrams, count);
+   }
+
+   int ImpairedTransport::ReceiveInPlace(Datagram datagrams[], int count)
+   {
+      Flush();
+      return mTransport.ReceiveInPlace(datagrams, count);
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   float ImpairedTransport::Random()
+   {
+      // xorshift64*, keeping the top 24 bits so the result fits a float exactly
+      mState ^= mState >> 12;
+      mState ^= mState << 25;
+      mState ^= mState >> 27;
+      const unsigned long long bits = (mState * 0x2545F4914F6CDD1DULL) >> 40;
+      return float(bits) / float(1 << 24);
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
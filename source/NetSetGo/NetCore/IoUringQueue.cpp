@@ -0,0 +1,533 @@
+#include <NetSetGo/NetCore/IoUringQueue.h>
+
+#if NET_PLATFORM == NET_PLATFORM_UNIX && defined(__linux__) && defined(NETSETGO_IO_URING)
+#   define NET_IO_URING 1 // talk to the kernel through raw io_uring system calls
+#   include <linux/io_uring.h>
+#   include <sys/mman.h>
+#   include <sys/socket.h>
+#   include <sys/syscall.h>
+#   include <netinet/in.h>
+#   include <unistd.h>
+#   include <errno.h>
+#else
+#   define NET_IO_URING 0
+#endif
+
+#include <cassert>
+#include <cstring>
+#include <stdio.h>
+
+namespace net {
+
+#if NET_IO_URING
+   static const unsigned int kQueueDepth      = 256;  // submission entries
+   static const unsigned int kCompletionDepth = 1024; // room for every buffer plus a full batch of sends
+   // each buffer holds the recvmsg summary, the sender, any control data and
+   // the payload; coalesced datagrams need room for 64KB, so fewer are kept
+   static const unsigned int kBufferCount     = 256;  // must be a power of two
+   static const unsigned int kBufferSize      = 4096;
+   static const unsigned int kCoalescedBufferCount = 64;
+   static const unsigned int kCoalescedBufferSize  = 65536 + 256;
+   static const unsigned short kBufferGroup   = 0;
+   static const int kSendBatch                = 64;   // sends submitted per io_uring_enter()
+
+   // completions are told apart by what they were submitted with
+   static const unsigned long long kReceiveTag = 1;
+   static const unsigned long long kSendTag    = 2;
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+   IoUringQueue::IoUringQueue()
+      : mRing(-1)
+      , mSocket(-1)
+      , mRingMemory(NULL)
+      , mRingMemorySize(0)
+      , mEntries(NULL)
+      , mEntriesSize(0)
+      , mSubmitHead(NULL)
+      , mSubmitTail(NULL)
+      , mSubmitMask(0)
+      , mQueued(0)
+      , mCompleteHead(NULL)
+      , mCompleteTail(NULL)
+      , mCompleteMask(0)
+      , mCompletions(NULL)
+      , mBufferRing(NULL)
+      , mBuffers(NULL)
+      , mBufferCount(0)
+      , mBufferSize(0)
+      , mBufferTail(0)
+      , mReceiveHeader(NULL)
+      , mArmed(false)
+      , mRefused(false)
+      , mSendsCompleted(0)
+      , mSendsSucceeded(0)
+      , mReceiveDrops(0)
+      , mSendDrops(0)
+      , mNextReceived(0)
+   {
+   }
+
+   IoUringQueue::~IoUringQueue()
+   {
+      Stop();
+   }
+
+   bool IoUringQueue::Start(int socket, bool coalesced, bool timestamped)
+   {
+      assert(!IsRunning());
+
+#if NET_IO_URING
+      io_uring_params params;
+      memset(&params, 0, sizeof(params));
+      params.flags = IORING_SETUP_CQSIZE;
+      params.cq_entries = kCompletionDepth;
+
+      mRing = int(syscall(__NR_io_uring_setup, kQueueDepth, &params));
+      if (mRing < 0)
+      {
+         return false; // no io_uring here (or it has been switched off)
+      }
+      mSocket = socket;
+
+      // map the submission and completion rings (one mapping on any kernel new
+      // enough for multishot receives) and the submission entries
+      if (!(params.features & IORING_FEAT_SINGLE_MMAP))
+      {
+         Stop();
+         return false;
+      }
+
+      const size_t submitSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+      const size_t completeSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+      mRingMemorySize = submitSize > completeSize ? submitSize : completeSize;
+      mRingMemory = mmap(NULL, mRingMemorySize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQ_RING);
+      mEntriesSize = params.sq_entries * sizeof(io_uring_sqe);
+      mEntries = mmap(NULL, mEntriesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, mRing, IORING_OFF_SQES);
+      if (mRingMemory == MAP_FAILED || mEntries == MAP_FAILED)
+      {
+         mRingMemory = mRingMemory == MAP_FAILED ? NULL : mRingMemory;
+         mEntries = mEntries == MAP_FAILED ? NULL : mEntries;
+         printf("failed to map io_uring\n");
+         Stop();
+         return false;
+      }
+
+      unsigned char* ring = reinterpret_cast<unsigned char*>(mRingMemory);
+      mSubmitHead   = reinterpret_cast<unsigned int*>(ring + params.sq_off.head);
+      mSubmitTail   = reinterpret_cast<unsigned int*>(ring + params.sq_off.tail);
+      mSubmitMask   = *reinterpret_cast<unsigned int*>(ring + params.sq_off.ring_mask);
+      mCompleteHead = reinterpret_cast<unsigned int*>(ring + params.cq_off.head);
+      mCompleteTail = reinterpret_cast<unsigned int*>(ring + params.cq_off.tail);
+      mCompleteMask = *reinterpret_cast<unsigned int*>(ring + params.cq_off.ring_mask);
+      mCompletions  = ring + params.cq_off.cqes;
+
+      // slot i of the submission array always names entry i, so it is filled in once
+      unsigned int* submitArray = reinterpret_cast<unsigned int*>(ring + params.sq_off.array);
+      for (unsigned int i = 0; i < params.sq_entries; ++i)
+      {
+         submitArray[i] = i;
+      }
+
+      // register the ring of buffers the kernel picks from as datagrams arrive
+      mBufferCount = coalesced ? kCoalescedBufferCount : kBufferCount;
+      mBufferSize = coalesced ? kCoalescedBufferSize : kBufferSize;
+      const size_t bufferRingSize = mBufferCount * sizeof(io_uring_buf);
+      mBufferRing = mmap(NULL, bufferRingSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (mBufferRing == MAP_FAILED)
+      {
+         mBufferRing = NULL;
+         Stop();
+         return false;
+      }
+
+      io_uring_buf_reg registration;
+      memset(&registration, 0, sizeof(registration));
+      registration.ring_addr = reinterpret_cast<unsigned long>(mBufferRing);
+      registration.ring_entries = mBufferCount;
+      registration.bgid = kBufferGroup;
+      if (syscall(__NR_io_uring_register, mRing, IORING_REGISTER_PBUF_RING, &registration, 1) < 0)
+      {
+         Stop(); // kernel predates provided buffer rings
+         return false;
+      }
+
+      mBuffers = new unsigned char[mBufferCount * mBufferSize];
+      for (unsigned int i = 0; i < mBufferCount; ++i)
+      {
+         Recycle((unsigned short)i);
+      }
+
+      msghdr* header = new msghdr;
+      memset(header, 0, sizeof(*header));
+      header->msg_namelen = sizeof(sockaddr_in);
+      header->msg_controllen = Socket::GetControlSize(coalesced, timestamped); // room for the UDP_GRO segment size and timestamp
+      mReceiveHeader = header;
+
+      // post the receive, and see that the kernel took it
+      if (!Arm())
+      {
+         Stop();
+         return false;
+      }
+      Reap();
+      if (mRefused)
+      {
+         Stop(); // kernel predates multishot receives
+         return false;
+      }
+
+      return true;
+#else
+      (void)socket;
+      (void)coalesced;
+      (void)timestamped;
+      return false;
+#endif
+   }
+
+   void IoUringQueue::Stop()
+   {
+#if NET_IO_URING
+      // closing the ring cancels the posted receive and drops the buffer registration
+      if (mRing >= 0)
+      {
+         close(mRing);
+         mRing = -1;
+      }
+      if (mRingMemory)
+      {
+         munmap(mRingMemory, mRingMemorySize);
+         mRingMemory = NULL;
+      }
+      if (mEntries)
+      {
+         munmap(mEntries, mEntriesSize);
+         mEntries = NULL;
+      }
+      if (mBufferRing)
+      {
+         munmap(mBufferRing, mBufferCount * sizeof(io_uring_buf));
+         mBufferRing = NULL;
+      }
+      delete [] mBuffers;
+      mBuffers = NULL;
+      delete reinterpret_cast<msghdr*>(mReceiveHeader);
+      mReceiveHeader = NULL;
+#endif
+
+      mSocket = -1;
+      mBufferTail = 0;
+      mArmed = false;
+      mRefused = false;
+      mReceived.clear();
+      mNextReceived = 0;
+      mHandedOut.clear();
+   }
+
+   bool IoUringQueue::HasCompletions() const
+   {
+      if (mNextReceived < mReceived.size())
+      {
+         return true;
+      }
+
+#if NET_IO_URING
+      if (IsRunning())
+      {
+         return *mCompleteHead != __atomic_load_n(mCompleteTail, __ATOMIC_ACQUIRE);
+      }
+#endif
+
+      return false;
+   }
+
+   int IoUringQueue::Send(const Socket::Datagram datagrams[], int count)
+   {
+      assert(datagrams || count == 0);
+
+      int sent = 0;
+
+#if NET_IO_URING
+      msghdr messages[kSendBatch];
+      iovec vectors[kSendBatch];
+      sockaddr_in addresses[kSendBatch];
+
+      int index = 0;
+      while (index < count && IsRunning())
+      {
+         const int batchSize = (count - index) < kSendBatch ? (count - index) : kSendBatch;
+         for (int i = 0; i < batchSize; ++i)
+         {
+            const Socket::Datagram& datagram = datagrams[index + i];
+            assert(datagram.mData);
+            assert(datagram.mSize > 0);
+            assert(datagram.mAddress.GetAddress() != 0);
+            assert(datagram.mAddress.GetPort() != 0);
+
+            addresses[i].sin_family = AF_INET;
+            addresses[i].sin_addr.s_addr = htonl(datagram.mAddress.GetAddress());
+            addresses[i].sin_port = htons((unsigned short)datagram.mAddress.GetPort());
+            memset(&addresses[i].sin_zero, 0, sizeof(addresses[i].sin_zero));
+            vectors[i].iov_base = datagram.mData;
+            vectors[i].iov_len = datagram.mSize;
+            memset(&messages[i], 0, sizeof(messages[i]));
+            messages[i].msg_name = &addresses[i];
+            messages[i].msg_namelen = sizeof(sockaddr_in);
+            messages[i].msg_iov = &vectors[i];
+            messages[i].msg_iovlen = 1;
+
+            // MSG_DONTWAIT: a full socket buffer fails the send, as with a non-blocking sendto()
+            io_uring_sqe* entry = reinterpret_cast<io_uring_sqe*>(NextEntry());
+            assert(entry); // every submission is consumed by the io_uring_enter() that submits it
+            entry->opcode = IORING_OP_SENDMSG;
+            entry->fd = mSocket;
+            entry->addr = reinterpret_cast<unsigned long>(&messages[i]);
+            entry->len = 1;
+            entry->msg_flags = MSG_DONTWAIT;
+            entry->user_data = kSendTag;
+         }
+
+         // the messages live on our stack, so wait for every send to finish with them
+         mSendsCompleted = 0;
+         mSendsSucceeded = 0;
+         bool submitted = Submit(batchSize);
+         Reap();
+         while (submitted && mSendsCompleted < batchSize)
+         {
+            submitted = Submit(1);
+            Reap();
+         }
+
+         sent += mSendsSucceeded;
+         index += batchSize;
+      }
+#endif
+
+      return sent;
+   }
+
+   int IoUringQueue::Receive(Socket::Datagram datagrams[], int count, bool wait)
+   {
+      assert(datagrams || count == 0);
+
+      int received = 0;
+
+#if NET_IO_URING
+      if (!IsRunning())
+      {
+         return 0;
+      }
+
+      if (mNextReceived == mReceived.size())
+      {
+         mReceived.clear();
+         mNextReceived = 0;
+         Reap();
+      }
+
+      // the receive stops if the kernel runs out of buffers, so put it back up
+      if (!mArmed && !mRefused)
+      {
+         Arm();
+      }
+
+      while (wait && mReceived.empty() && !mRefused)
+      {
+         if (!Submit(1))
+         {
+            break;
+         }
+         Reap();
+      }
+
+      if (mRefused)
+      {
+         printf("io_uring refused to receive, falling back to system calls\n");
+         Stop();
+         return 0;
+      }
+
+      const msghdr* header = reinterpret_cast<const msghdr*>(mReceiveHeader);
+      while (received < count && mNextReceived < mReceived.size())
+      {
+         const unsigned short index = mReceived[mNextReceived++];
+         unsigned char* buffer = &mBuffers[index * mBufferSize];
+
+         // the kernel lays out a summary, then the sender, then control data, then the payload
+         const io_uring_recvmsg_out* summary = reinterpret_cast<const io_uring_recvmsg_out*>(buffer);
+         const sockaddr_in* from = reinterpret_cast<const sockaddr_in*>(buffer + sizeof(io_uring_recvmsg_out));
+         unsigned char* control = buffer + sizeof(io_uring_recvmsg_out) + header->msg_namelen;
+         unsigned char* payload = control + header->msg_controllen;
+
+         Socket::Datagram& datagram = datagrams[received++];
+         datagram.mAddress = Address(ntohl(from->sin_addr.s_addr), ntohs(from->sin_port));
+         datagram.mData = payload;
+         datagram.mSize = (summary->flags & MSG_TRUNC) ? 0 : int(summary->payloadlen);
+         datagram.mSegmentSize = datagram.mSize;
+         mHandedOut.push_back(index);
+
+         // pick the segment size and arrival time out of the control data
+         msghdr controlHeader;
+         memset(&controlHeader, 0, sizeof(controlHeader));
+         controlHeader.msg_control = control;
+         controlHeader.msg_controllen = summary->controllen;
+         datagram.mTime = 0.0;
+         Socket::ReadControl(&controlHeader, datagram, mReceiveDrops);
+      }
+#else
+      (void)wait;
+#endif
+
+      return received;
+   }
+
+   void IoUringQueue::Release()
+   {
+      for (size_t i = 0; i < mHandedOut.size(); ++i)
+      {
+         Recycle(mHandedOut[i]);
+      }
+      mHandedOut.clear();
+
+      if (!mArmed && IsRunning())
+      {
+         Arm();
+      }
+   }
+
+   void* IoUringQueue::NextEntry()
+   {
+#if NET_IO_URING
+      const unsigned int tail = *mSubmitTail + mQueued;
+      const unsigned int head = __atomic_load_n(mSubmitHead, __ATOMIC_ACQUIRE);
+      if (tail - head >= kQueueDepth)
+      {
+         return NULL;
+      }
+
+      io_uring_sqe* entry = &reinterpret_cast<io_uring_sqe*>(mEntries)[tail & mSubmitMask];
+      memset(entry, 0, sizeof(*entry));
+      ++mQueued;
+      return entry;
+#else
+      return NULL;
+#endif
+   }
+
+   bool IoUringQueue::Arm()
+   {
+#if NET_IO_URING
+      io_uring_sqe* entry = reinterpret_cast<io_uring_sqe*>(NextEntry());
+      if (!entry)
+      {
+         return false;
+      }
+
+      entry->opcode = IORING_OP_RECVMSG;
+      entry->fd = mSocket;
+      entry->addr = reinterpret_cast<unsigned long>(mReceiveHeader);
+      entry->len = 1;
+      entry->ioprio = IORING_RECV_MULTISHOT;
+      entry->flags = IOSQE_BUFFER_SELECT;
+      entry->buf_group = kBufferGroup;
+      entry->user_data = kReceiveTag;
+
+      mArmed = Submit(0);
+#endif
+
+      return mArmed;
+   }
+
+   bool IoUringQueue::Submit(unsigned int minComplete)
+   {
+#if NET_IO_URING
+      // hand over everything NextEntry() gave out since last time
+      const unsigned int toSubmit = mQueued;
+      __atomic_store_n(mSubmitTail, *mSubmitTail + toSubmit, __ATOMIC_RELEASE);
+      mQueued = 0;
+
+      const unsigned int flags = minComplete > 0 ? IORING_ENTER_GETEVENTS : 0;
+      long result;
+      do
+      {
+         result = syscall(__NR_io_uring_enter, mRing, toSubmit, minComplete, flags, NULL, 0);
+      }
+      while (result < 0 && errno == EINTR);
+
+      if (result < 0)
+      {
+         printf("io_uring_enter failed (error %d)\n", errno);
+         return false;
+      }
+
+      return true;
+#else
+      (void)minComplete;
+      return false;
+#endif
+   }
+
+   void IoUringQueue::Reap()
+   {
+#if NET_IO_URING
+      const io_uring_cqe* completions = reinterpret_cast<const io_uring_cqe*>(mCompletions);
+      unsigned int head = *mCompleteHead;
+      const unsigned int tail = __atomic_load_n(mCompleteTail, __ATOMIC_ACQUIRE);
+      for (; head != tail; ++head)
+      {
+         const io_uring_cqe& completion = completions[head & mCompleteMask];
+         if (completion.user_data == kReceiveTag)
+         {
+            if (completion.flags & IORING_CQE_F_BUFFER)
+            {
+               mReceived.push_back((unsigned short)(completion.flags >> IORING_CQE_BUFFER_SHIFT));
+            }
+
+            if (!(completion.flags & IORING_CQE_F_MORE))
+            {
+               // running out of buffers is expected under load; anything the
+               // kernel rejects outright means it cannot do this at all
+               mArmed = false;
+               mRefused = mRefused || completion.res == -EINVAL || completion.res == -EOPNOTSUPP;
+            }
+         }
+         else if (completion.user_data == kSendTag)
+         {
+            ++mSendsCompleted;
+            if (completion.res >= 0)
+            {
+               ++mSendsSucceeded;
+            }
+            else if (completion.res == -EAGAIN || completion.res == -ENOBUFS)
+            {
+               ++mSendDrops;
+            }
+         }
+      }
+      __atomic_store_n(mCompleteHead, head, __ATOMIC_RELEASE);
+#endif
+   }
+
+   void IoUringQueue::Recycle(unsigned short buffer)
+   {
+#if NET_IO_URING
+      // io_uring_buf_ring::bufs is a flexible array member that C++ lays out
+      // differently, so the ring is walked as a plain array of entries, the
+      // first of which has the tail overlaid on its last field
+      io_uring_buf* entries = reinterpret_cast<io_uring_buf*>(mBufferRing);
+      io_uring_buf& entry = entries[mBufferTail & (mBufferCount - 1)];
+      entry.addr = reinterpret_cast<unsigned long>(&mBuffers[buffer * mBufferSize]);
+      entry.len = mBufferSize;
+      entry.bid = buffer;
+      ++mBufferTail;
+      __atomic_store_n(&entries[0].resv, mBufferTail, __ATOMIC_RELEASE);
+#else
+      (void)buffer;
+#endif
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
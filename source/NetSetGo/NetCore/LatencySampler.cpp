@@ -0,0 +1,57 @@
+#include <NetSetGo/NetCore/LatencySampler.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   LatencySampler::LatencySampler(int capacity)
+      : mCapacity(capacity > 0 ? capacity : 1)
+      , mNumAdded(0)
+   {
+      mSamples.reserve(mCapacity);
+   }
+
+   void LatencySampler::AddSample(double latency)
+   {
+      if (mSamples.size() < size_t(mCapacity))
+      {
+         mSamples.push_back(latency);
+      }
+      else
+      {
+         mSamples[mNumAdded % mCapacity] = latency;
+      }
+      ++mNumAdded;
+   }
+
+   void LatencySampler::Reset()
+   {
+      mSamples.clear();
+      mNumAdded = 0;
+   }
+
+   double LatencySampler::GetPercentile(float percentile) const
+   {
+      if (mSamples.empty())
+      {
+         return 0.0;
+      }
+
+      // nearest rank: the smallest sample with at least percentile percent at or below it
+      percentile = percentile < 0.0f ? 0.0f : (percentile > 100.0f ? 100.0f : percentile);
+      size_t rank = size_t(std::ceil(double(percentile) * mSamples.size() / 100.0));
+      rank = rank > 0 ? rank - 1 : 0;
+      assert(rank < mSamples.size());
+
+      mSorted = mSamples;
+      std::nth_element(mSorted.begin(), mSorted.begin() + rank, mSorted.end());
+      return mSorted[rank];
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -1,14 +1,43 @@
 #include <NetSetGo/NetCore/Mesh.h>
+#include <NetSetGo/NetCore/MeshTable.h>
 
 // these are only included to satisfy an aggravating special case
 #include <NetSetGo/NetCore/NetworkEngine.h>
 
+#include <NetSetGo/NetCore/Serialization.h>
+#include <NetSetGo/NetCore/netassert.h>
+
+#include <algorithm>
 #include <cassert>
 #include <cstdlib>
 #include <cstdio>
+#include <cstring>
 
 namespace net {
 
+   // a node that has not acknowledged any of the last this many tables
+   // published to the multicast group gets the table directly instead
+   static const unsigned int kMulticastAckWindow = 8;
+
+   // the most a page of the table has in front of its addresses: the protocol
+   // id, the packet type, the table version, the multicast sequence or, sent
+   // to one node, the version it follows on from, and its first node and
+   // number of nodes
+   static const int kMaxPageHeaderSize = 4 + 1 + 4 + 4 + 2 * int(kMaxVarIntSize);
+
+   // every this many sends, nodes are sent the table itself rather than what
+   // changed in it
+   static const int kKeyframeInterval = 16;
+
+   // how many versions back a change to the table can be found without
+   // looking through all of it, and how many packets back, per node, an ack
+   // can be told apart
+   static const unsigned int kChangeLogSize = 1024;
+   static const unsigned int kNumSentVersions = 32;
+
+   // how finely node time outs are kept, in seconds
+   static const float kTimeoutResolution = 1.0f / 64.0f;
+
 ////////////////////////////////////////////////////////////////////////////////
 
    bool Mesh::MeshPacketParser::ParsePacket(const Address& sender, const unsigned char data[], size_t size) const
@@ -25,7 +54,7 @@ namespace net {
       }
 
       // determine packet type
-      enum PacketType { ConnectRequest, KeepAlive };
+      enum PacketType { ConnectRequest, KeepAlive }; // see Node::SendPackets()
       PacketType packetType;
       if (data[4] == 0)
       {
@@ -46,27 +75,18 @@ namespace net {
       case ConnectRequest:
          {
             const NodeID nodeID = mMesh.GetNodeIDFromAddress(sender);
-            // is address already connecting or connected?
-            if (nodeID != NODEID_INVALID)
-            {
-               NodeState* node = mMesh.GetNodeByID(nodeID);
-               if (node->mCurrentState == Connecting)
-               {
-                  // reset timeout accumulator, but only while connecting
-                  node->mTimeoutAccumulator = 0.0f;
-               }
-            }
-            else
+            // is address already connecting or connected? then there's
+            // nothing to do, as nodes only start to time out once connected
+            if (nodeID == NODEID_INVALID)
             {
                // no entry for address, start connect process...
                const NodeID freeSlot = mMesh.FindFirstUnreservedNode();
-               NodeState* node = mMesh.GetNodeByID(freeSlot);
-               if (node)
+               if (mMesh.GetNodeByID(freeSlot))
                {
                   printf("mesh accepts %d.%d.%d.%d:%d as node %d\n",
                      sender.GetA(), sender.GetB(), sender.GetC(), sender.GetD(), sender.GetPort(), freeSlot);
 
-                  assert(node->mCurrentState == Disconnected);
+                  assert(mMesh.GetNodeCurrentState(freeSlot) == Disconnected);
                   mMesh.Reserve(freeSlot, sender);
                }
             }
@@ -77,16 +97,20 @@ namespace net {
             const NodeID nodeID = mMesh.GetNodeIDFromAddress(sender);
             if (nodeID != NODEID_INVALID)
             {
-               NodeState* node = mMesh.GetNodeByID(nodeID);
                // progress from "connection accept" to "connected"
-               if (node->mCurrentState == NetworkTopology::Connecting)
+               if (mMesh.GetNodeCurrentState(nodeID) == NetworkTopology::Connecting)
                {
-                  node->mCurrentState = NetworkTopology::Connected;
-                  node->mReserved = false;
+                  mMesh.SetNodeCurrentState(nodeID, NetworkTopology::Connected);
+                  mMesh.SetNodeReserved(nodeID, false);
                   printf("mesh completes connection of node %d\n", nodeID);
                }
-               // reset timeout accumulator for node
-               node->mTimeoutAccumulator = 0.0f;
+               // push back the node's time out
+               mMesh.mTimeouts.Schedule(nodeID - mMesh.GetFirstNodeID(), mMesh.mTimeout);
+               // and note what it last heard through the multicast group, if anything
+               if (size == 9)
+               {
+                  ReadInteger(&data[5], mMesh.mMulticastAcks[nodeID - mMesh.GetFirstNodeID()]);
+               }
             }
          }
          break;
@@ -100,10 +124,41 @@ namespace net {
    Mesh::Mesh(unsigned int protocolId, int maxNodes, float sendRate, float timeout)
       : NetworkTopology(protocolId, new MeshPacketParser(*this), sendRate, timeout, 256) // using 256 for max packet size?
       , kMaxNodes(maxNodes)
+      , mTable(NULL)
+      , mPagedTable(false)
+      , mNextPage(0)
+      , mNextKeyframePage(0)
+      , mSendsUntilKeyframe(kKeyframeInterval)
+      , mTableVersion(0)
+      , mTimeouts(kTimeoutResolution, maxNodes)
+      , mMulticastSequence(0)
+      , mMulticastAcks(maxNodes, 0)
+   {
+      assert(kMaxNodes >= 1);
+      NetworkTopology::Reserve(kMaxNodes);
+      ResetTableVersions();
+   }
+
+   Mesh::Mesh(unsigned int protocolId, MeshTable& table, NodeID firstNodeID, int numNodes, float sendRate, float timeout)
+      : NetworkTopology(protocolId, new MeshPacketParser(*this), sendRate, timeout, 256)
+      , kMaxNodes(numNodes)
+      , mTable(&table)
+      , mPagedTable(false)
+      , mNextPage(0)
+      , mNextKeyframePage(0)
+      , mSendsUntilKeyframe(kKeyframeInterval)
+      , mTableVersion(0)
+      , mTimeouts(kTimeoutResolution, numNodes)
+      , mMulticastSequence(0)
+      , mMulticastAcks(numNodes, 0)
    {
       assert(kMaxNodes >= 1);
-      assert(kMaxNodes <= 255);
+      assert(firstNodeID >= 0);
+      assert(firstNodeID + kMaxNodes <= mTable->GetNumNodes());
+      SetFirstNodeID(firstNodeID);
+      AddSocketOptions(Socket::LoadBalance);
       NetworkTopology::Reserve(kMaxNodes);
+      ResetTableVersions();
    }
 
    void Mesh::Stop()
@@ -126,32 +181,87 @@ namespace net {
       }
    }
 
-   NodeID Mesh::FindFirstUnreservedNode() const
+   float Mesh::GetTimeUntilNextDeadline() const
    {
-      NodeID freeSlot = NODEID_INVALID;
-      for (int i = 0; i < GetNumNodesReserved(); ++i)
+      float timeUntilDeadline = NetworkTopology::GetTimeUntilNextDeadline();
+
+      const float timeUntilTimeout = mTimeouts.GetTimeUntilNext();
+      if (timeUntilTimeout < timeUntilDeadline)
       {
-         if (GetNodeCurrentState(NodeID(i)) == NetworkTopology::Disconnected)
-         {
-            freeSlot = NodeID(i);
-            break;
-         }
+         timeUntilDeadline = timeUntilTimeout;
+      }
+
+      return timeUntilDeadline;
+   }
+
+   void Mesh::SetMulticastGroup(const Address& group)
+   {
+      netassert(group == Address() || group.IsMulticastAddress());
+      mMulticastGroup = group;
+   }
+
+   bool Mesh::IsNodeOnMulticast(NodeID nodeID) const
+   {
+      const int index = int(nodeID) - int(GetFirstNodeID());
+      if (mMulticastGroup == Address() || index < 0 || index >= kMaxNodes)
+      {
+         return false;
       }
-      return freeSlot;
+      const unsigned int ack = mMulticastAcks[index];
+      return ack != 0 && mMulticastSequence - ack < kMulticastAckWindow;
+   }
+
+   void Mesh::SetPagedTable(bool pagedTable)
+   {
+      mPagedTable = pagedTable;
+   }
+
+   bool Mesh::UsesPagedTable() const
+   {
+      // the whole table goes out in multicast packets, the bigger kind
+      const int numNodes = GetNumTableNodes();
+      return mPagedTable || numNodes > 255 || 13 + 6 * numNodes > GetMaxPacketSize();
+   }
+
+   int Mesh::GetTablePageSize() const
+   {
+      const int pageSize = (GetMaxPacketSize() - kMaxPageHeaderSize) / 6;
+      netassert(pageSize >= 1);
+      return pageSize >= 1 ? pageSize : 1;
+   }
+
+   unsigned int Mesh::GetNodeTableVersion(NodeID nodeID) const
+   {
+      const int index = int(nodeID) - int(GetFirstNodeID());
+      return index >= 0 && index < kMaxNodes ? mAckedVersions[index] : 0;
+   }
+
+   NodeID Mesh::FindFirstUnreservedNode() const
+   {
+      return FindFirstFreeNode();
    }
 
    void Mesh::Reserve(NodeID nodeID, const Address& address)
    {
       assert(nodeID > NODEID_INVALID);
-      assert(nodeID < NodeID(GetNumNodesReserved()));
+      assert(GetNodeByID(nodeID));
       printf("mesh reserves node id %d for %d.%d.%d.%d:%d\n",
          nodeID, address.GetA(), address.GetB(), address.GetC(), address.GetD(), address.GetPort());
 
-      NodeState* node = GetNodeByID(nodeID);
-      node->mCurrentState = NetworkTopology::Connecting;
-      node->mAddress      = address;
-      node->mReserved     = true;
-      mAddrToNodeID.insert(std::make_pair(address, nodeID));
+      SetNodeCurrentState(nodeID, NetworkTopology::Connecting);
+      SetNodeAddress(nodeID, address);
+      SetNodeReserved(nodeID, true);
+      mAddrToNodeID.Insert(address, nodeID);
+      mMulticastAcks[nodeID - GetFirstNodeID()] = 0;
+      mTimeouts.Cancel(nodeID - GetFirstNodeID()); // until it keeps alive
+
+      // a newcomer has none of the table
+      const int index = nodeID - GetFirstNodeID();
+      mAckedVersions[index] = 0;
+      for (unsigned int i = 0; i < kNumSentVersions; ++i)
+      {
+         mSentVersions[index * kNumSentVersions + i].mVersion = 0;
+      }
    }
 
    std::string Mesh::GetIdentity() const
@@ -163,87 +273,358 @@ namespace net {
 
    void Mesh::SendPackets(float deltaTime)
    {
+      // a shard publishes the nodes it owns, and tells its nodes about everyone
+      if (mTable)
+      {
+         for (int i = 0; i < GetNumNodesReserved(); ++i)
+         {
+            mTable->SetAddress(GetFirstNodeID() + i, GetNodeAddress(GetFirstNodeID() + i));
+         }
+      }
+      const int numNodes = GetNumTableNodes();
+      const bool paged = UsesPagedTable();
+
+      // the acks of what we sent tell us which versions of the table nodes have
+      for (NodeID nodeID = GetFirstActiveNode(); nodeID != NODEID_INVALID; nodeID = GetNextActiveNode(nodeID))
+      {
+         ProcessTableAcks(nodeID);
+      }
+
       mSendAccumulator += deltaTime;
       while (mSendAccumulator > mSendRate)
       {
-         for (int i = 0; i < GetNumNodesReserved(); ++i)
+         UpdateTableVersions();
+         const bool keyframe = --mSendsUntilKeyframe <= 0;
+         if (keyframe)
          {
-            switch (GetNodeCurrentState(NodeID(i)))
+            mSendsUntilKeyframe = kKeyframeInterval;
+         }
+
+         // this send carries the whole table, or the next page of it: the
+         // group hears a page every send, and nodes on their own one every
+         // keyframe, each going round the whole table in turn
+         NodeID firstNodeID = 0;
+         int numPageNodes = numNodes;
+         NodeID keyframeFirstNodeID = 0;
+         int keyframeNumNodes = numNodes;
+         if (paged)
+         {
+            firstNodeID = NextPage(mNextPage, numNodes, numPageNodes);
+            if (keyframe)
+            {
+               keyframeFirstNodeID = NextPage(mNextKeyframePage, numNodes, keyframeNumNodes);
+            }
+         }
+
+         // publish the table to the multicast group once for everybody connected
+         bool anyConnected = false;
+         for (NodeID nodeID = GetFirstActiveNode(); nodeID != NODEID_INVALID && !anyConnected; nodeID = GetNextActiveNode(nodeID))
+         {
+            anyConnected = GetNodeCurrentState(nodeID) == NetworkTopology::Connected;
+         }
+         if (mMulticastGroup != Address() && anyConnected)
+         {
+            mMulticastSequence = mMulticastSequence + 1 != 0 ? mMulticastSequence + 1 : 1; // 0 means nothing heard
+            unsigned char* packet = reinterpret_cast<unsigned char*>(alloca(kMaxPageHeaderSize + 6*numPageNodes));
+            WriteInteger(&packet[0], mProtocolID);
+            packet[4] = paged ? 6 : 3;
+            WriteInteger(&packet[5], mMulticastSequence);
+            WriteInteger(&packet[9], mTableVersion);
+            size_t position = 13;
+            if (paged)
+            {
+               position += WriteVarInt(&packet[position], firstNodeID);
+               position += WriteVarInt(&packet[position], numPageNodes);
+            }
+            WriteTable(&packet[position], firstNodeID, numPageNodes);
+            MulticastPacket(mMulticastGroup, packet, int(position + 6*numPageNodes));
+         }
+
+         for (NodeID nodeID = GetFirstActiveNode(); nodeID != NODEID_INVALID; nodeID = GetNextActiveNode(nodeID))
+         {
+            switch (GetNodeCurrentState(nodeID))
             {
             case NetworkTopology::Connecting:
                {
-                  // node is negotiating connect: send "connection accepted" packets
-                  unsigned char packet[7];
+                  // node is negotiating connect: send "connection accepted" packets,
+                  // naming the multicast group to subscribe to, if there is one
+                  unsigned char packet[5 + 2*kMaxVarIntSize + 6];
+                  WriteInteger(&packet[0], mProtocolID);
+                  size_t position = 5;
+                  if (paged)
+                  {
+                     packet[4] = 4;
+                     position += WriteVarInt(&packet[position], nodeID);
+                     position += WriteVarInt(&packet[position], numNodes);
+                  }
+                  else
+                  {
+                     packet[4] = 0;
+                     position += WriteByte(&packet[position], (unsigned char)nodeID);
+                     position += WriteByte(&packet[position], (unsigned char)numNodes);
+                  }
+                  if (mMulticastGroup != Address())
+                  {
+                     position += WriteInteger(&packet[position], mMulticastGroup.GetAddress());
+                     position += WriteShort(&packet[position], mMulticastGroup.GetPort());
+                  }
+                  const bool success = QueuePacket(GetNodeAddress(nodeID), GetNodeByID(nodeID)->mReliabilitySystem, packet, int(position));
+                  //printf("Mesh sending ConnectionAccepted packet of size %d; success: %s\n", int(position), success ? "yes" : "no");
+               }
+               break;
+            case NetworkTopology::Connected:
+               if (IsNodeOnMulticast(nodeID))
+               {
+                  // node hears the table through the group: send "heartbeat" packets
+                  unsigned char packet[5];
                   packet[0] = (unsigned char)((mProtocolID >> 24) & 0xFF);
                   packet[1] = (unsigned char)((mProtocolID >> 16) & 0xFF);
                   packet[2] = (unsigned char)((mProtocolID >> 8)  & 0xFF);
                   packet[3] = (unsigned char)((mProtocolID) & 0xFF);
-                  packet[4] = 0;
-                  packet[5] = (unsigned char)i;
-                  packet[6] = (unsigned char)GetNumNodesReserved();
-                  const bool success = SendPacket(GetNodeAddress(NodeID(i)), GetNodeByID(NodeID(i))->mReliabilitySystem, packet, sizeof(packet));
-                  //printf("Mesh sending ConnectionAccepted packet of size %d; success: %s\n", sizeof(packet), success ? "yes" : "no");
+                  packet[4] = 2;
+                  QueuePacket(GetNodeAddress(nodeID), GetNodeByID(nodeID)->mReliabilitySystem, packet, sizeof(packet));
                }
-               break;
-            case NetworkTopology::Connected:
+               else if (keyframe)
                {
                   // node is connected: send "update" packets
-                  const size_t packetSize = 5+6*GetNumNodesReserved();
                   //               unsigned char packet[packetSize];
-                  unsigned char* packet = reinterpret_cast<unsigned char*>(alloca(packetSize));
+                  unsigned char* packet = reinterpret_cast<unsigned char*>(alloca(kMaxPageHeaderSize + 6*keyframeNumNodes));
                   packet[0] = (unsigned char)((mProtocolID >> 24) & 0xFF);
                   packet[1] = (unsigned char)((mProtocolID >> 16) & 0xFF);
                   packet[2] = (unsigned char)((mProtocolID >> 8)  & 0xFF);
                   packet[3] = (unsigned char)((mProtocolID)       & 0xFF);
-                  packet[4] = 1;
-                  unsigned char* ptr = &packet[5];
-                  for (int j = 0; j < GetNumNodesReserved(); ++j)
+                  packet[4] = paged ? 5 : 1;
+                  size_t position = 9;
+                  unsigned int version = mTableVersion; // the whole table brings the node right up to date
+                  if (paged)
                   {
-                     const net::Address& address = GetNodeAddress(NodeID(j));
-                     ptr[0] = (unsigned char)address.GetA();
-                     ptr[1] = (unsigned char)address.GetB();
-                     ptr[2] = (unsigned char)address.GetC();
-                     ptr[3] = (unsigned char)address.GetD();
-                     ptr[4] = (unsigned char)((address.GetPort() >> 8) & 0xFF);
-                     ptr[5] = (unsigned char)((address.GetPort()) & 0xFF);
-                     ptr += 6;
+                     // whereas a page brings it only as far as the rest of the table stayed as it has it
+                     const unsigned int baseVersion = mAckedVersions[nodeID - GetFirstNodeID()];
+                     version = GetPageVersion(baseVersion, keyframeFirstNodeID, keyframeNumNodes);
+                     position += WriteInteger(&packet[position], baseVersion);
+                     position += WriteVarInt(&packet[position], keyframeFirstNodeID);
+                     position += WriteVarInt(&packet[position], keyframeNumNodes);
                   }
-                  const net::Address& nodeAddress = GetNodeAddress(NodeID(i));
-                  const bool success = SendPacket(nodeAddress, GetNodeByID(NodeID(i))->mReliabilitySystem, packet, packetSize);
-                  //printf("Mesh sending Update packet of size %d to node %d at address %d.%d.%d.%d:%d; success: %s\n", packetSize, NodeID(i),
+                  WriteInteger(&packet[5], version);
+                  WriteTable(&packet[position], keyframeFirstNodeID, keyframeNumNodes);
+                  const size_t packetSize = position + 6*keyframeNumNodes;
+                  const net::Address& nodeAddress = GetNodeAddress(nodeID);
+                  ReliabilitySystem& reliabilitySystem = GetNodeByID(nodeID)->mReliabilitySystem;
+                  RecordTableVersion(nodeID, reliabilitySystem.GetLocalSequence(), version);
+                  const bool success = QueuePacket(nodeAddress, reliabilitySystem, packet, int(packetSize));
+                  //printf("Mesh sending Update packet of size %d to node %d at address %d.%d.%d.%d:%d; success: %s\n", packetSize, nodeID,
                   //   nodeAddress.GetA(), nodeAddress.GetB(), nodeAddress.GetC(), nodeAddress.GetD(), nodeAddress.GetPort(),
                   //   success ? "yes" : "no");
                }
+               else
+               {
+                  // otherwise send "delta" packets, with what changed since
+                  // the version the node is known to have
+                  unsigned char* packet = reinterpret_cast<unsigned char*>(alloca(GetMaxPacketSize()));
+                  WriteInteger(&packet[0], mProtocolID);
+                  packet[4] = 7;
+                  unsigned int version = 0;
+                  const size_t size = 5 + WriteDelta(&packet[5], GetMaxPacketSize() - 5, mAckedVersions[nodeID - GetFirstNodeID()], version);
+                  ReliabilitySystem& reliabilitySystem = GetNodeByID(nodeID)->mReliabilitySystem;
+                  RecordTableVersion(nodeID, reliabilitySystem.GetLocalSequence(), version);
+                  QueuePacket(GetNodeAddress(nodeID), reliabilitySystem, packet, int(size));
+               }
                break;
             }
          }
          mSendAccumulator -= mSendRate;
       }
+
+      // send everything queued above in as few system calls as possible
+      FlushPackets();
    }
 
-   void Mesh::CheckForTimeouts(float deltaTime)
+   int Mesh::GetNumTableNodes() const
+   {
+      return mTable ? mTable->GetNumNodes() : GetNumNodesReserved();
+   }
+
+   void Mesh::WriteTable(unsigned char* ptr, NodeID firstNodeID, int numNodes) const
+   {
+      for (NodeID j = firstNodeID; j < firstNodeID + numNodes; ++j)
+      {
+         const net::Address& address = mSentTable[j];
+         ptr[0] = (unsigned char)address.GetA();
+         ptr[1] = (unsigned char)address.GetB();
+         ptr[2] = (unsigned char)address.GetC();
+         ptr[3] = (unsigned char)address.GetD();
+         ptr[4] = (unsigned char)((address.GetPort() >> 8) & 0xFF);
+         ptr[5] = (unsigned char)((address.GetPort()) & 0xFF);
+         ptr += 6;
+      }
+   }
+
+   void Mesh::ResetTableVersions()
+   {
+      const int numNodes = GetNumTableNodes();
+      mSendsUntilKeyframe = kKeyframeInterval;
+      mTableVersion = 0;
+      mSentTable.assign(numNodes, Address());
+      mEntryVersions.assign(numNodes, 0);
+      mChangeLog.assign(kChangeLogSize, NODEID_INVALID);
+      mAckedVersions.assign(kMaxNodes, 0);
+      SentVersion none;
+      none.mSequence = 0;
+      none.mVersion = 0;
+      mSentVersions.assign(kMaxNodes * kNumSentVersions, none);
+   }
+
+   void Mesh::UpdateTableVersions()
+   {
+      for (NodeID j = 0; j < NodeID(mSentTable.size()); ++j)
+      {
+         const net::Address address = mTable ? mTable->GetAddress(j) : GetNodeAddress(j);
+         if (address != mSentTable[j])
+         {
+            // every change is a version of its own, so a delta can stop after any of them
+            ++mTableVersion;
+            mSentTable[j] = address;
+            mEntryVersions[j] = mTableVersion;
+            mChangeLog[mTableVersion % kChangeLogSize] = j;
+         }
+      }
+   }
+
+   void Mesh::ProcessTableAcks(NodeID nodeID)
    {
-      for (int i = 0; i < GetNumNodesReserved(); ++i)
+      // taken as they arrive, while the ring still holds what they acked
+      const int index = nodeID - GetFirstNodeID();
+      const std::vector<unsigned int>& acks = GetNodeByID(nodeID)->mReliabilitySystem.GetAcks();
+      for (size_t i = 0; i < acks.size(); ++i)
       {
-         NodeState* node = GetNodeByID(NodeID(i));
-         if (GetNodeCurrentState(NodeID(i)) != NetworkTopology::Disconnected)
+         const SentVersion& sent = mSentVersions[index * kNumSentVersions + acks[i] % kNumSentVersions];
+         if (sent.mSequence == acks[i] && sent.mVersion > mAckedVersions[index])
          {
-            node->mTimeoutAccumulator += deltaTime;
-            if (node->mTimeoutAccumulator > mTimeout && !node->mReserved)
+            mAckedVersions[index] = sent.mVersion;
+         }
+      }
+   }
+
+   void Mesh::RecordTableVersion(NodeID nodeID, unsigned int sequence, unsigned int version)
+   {
+      SentVersion& sent = mSentVersions[(nodeID - GetFirstNodeID()) * kNumSentVersions + sequence % kNumSentVersions];
+      sent.mSequence = sequence;
+      sent.mVersion = version;
+   }
+
+   NodeID Mesh::NextPage(NodeID& cursor, int numNodes, int& numPageNodes) const
+   {
+      const NodeID firstNodeID = cursor < numNodes ? cursor : 0;
+      numPageNodes = numNodes - firstNodeID < GetTablePageSize() ? numNodes - firstNodeID : GetTablePageSize();
+      cursor = firstNodeID + numPageNodes;
+      return firstNodeID;
+   }
+
+   unsigned int Mesh::GetPageVersion(unsigned int baseVersion, NodeID firstNodeID, int numNodes) const
+   {
+      // as far as the first change to an entry not on the page, if the log
+      // reaches back to the base
+      unsigned int version = baseVersion;
+      if (mTableVersion - baseVersion <= kChangeLogSize)
+      {
+         while (version < mTableVersion)
+         {
+            const NodeID j = mChangeLog[(version + 1) % kChangeLogSize];
+            if (j < firstNodeID || j >= firstNodeID + numNodes)
             {
-               printf("mesh timed out node %d\n", i);
-               AddrToNodeID::iterator addr_itor = mAddrToNodeID.find(GetNodeAddress(i));
-               assert(addr_itor != mAddrToNodeID.end());
-               mAddrToNodeID.erase(addr_itor);
-               node->Reset();
+               break;
+            }
+            ++version;
+         }
+      }
+      return version;
+   }
 
-               // cheat: at this point we should disconnect the node's node, too
+   size_t Mesh::WriteDelta(unsigned char* ptr, size_t size, unsigned int baseVersion, unsigned int& version) const
+   {
+      // the entries changed since baseVersion, oldest change first; recent
+      // changes are in the log, older ones need looking for
+      std::vector<NodeID> changed;
+      if (mTableVersion - baseVersion <= kChangeLogSize)
+      {
+         for (unsigned int v = baseVersion + 1; v <= mTableVersion; ++v)
+         {
+            const NodeID j = mChangeLog[v % kChangeLogSize];
+            if (mEntryVersions[j] == v)
+            {
+               changed.push_back(j); // not changed again since
+            }
+         }
+      }
+      else
+      {
+         std::vector<std::pair<unsigned int, NodeID> > versions;
+         for (NodeID j = 0; j < NodeID(mEntryVersions.size()); ++j)
+         {
+            if (mEntryVersions[j] > baseVersion)
+            {
+               versions.push_back(std::make_pair(mEntryVersions[j], j));
+            }
+         }
+         std::sort(versions.begin(), versions.end());
+         for (size_t i = 0; i < versions.size(); ++i)
+         {
+            changed.push_back(versions[i].second);
+         }
+      }
+
+      // as many as fit, which brings the node up to the version of the last
+      const size_t kEntrySize = kMaxVarIntSize + 6;
+      size_t position = 4 + 4;
+      size_t countPosition = position;
+      position += kMaxVarIntSize; // the count goes here, once known
+      version = baseVersion;
+      size_t count = 0;
+      unsigned char* entries = ptr + position;
+      size_t entriesSize = 0;
+      for (; count < changed.size() && position + entriesSize + kEntrySize <= size; ++count)
+      {
+         const NodeID j = changed[count];
+         entriesSize += WriteVarInt(&entries[entriesSize], j);
+         entriesSize += WriteInteger(&entries[entriesSize], mSentTable[j].GetAddress());
+         entriesSize += WriteShort(&entries[entriesSize], mSentTable[j].GetPort());
+         version = mEntryVersions[j];
+      }
+      if (count == changed.size())
+      {
+         version = mTableVersion; // nothing more changed after these
+      }
+
+      // the count is written last, and the entries moved down against it
+      WriteInteger(&ptr[0], baseVersion);
+      WriteInteger(&ptr[4], version);
+      const size_t countSize = WriteVarInt(&ptr[countPosition], unsigned(count));
+      memmove(&ptr[countPosition + countSize], entries, entriesSize);
+      return countPosition + countSize + entriesSize;
+   }
+
+   void Mesh::CheckForTimeouts(float deltaTime)
+   {
+      // only the nodes whose time is up are looked at
+      mExpiredTimeouts.clear();
+      mTimeouts.Advance(deltaTime, mExpiredTimeouts);
+      for (size_t i = 0; i < mExpiredTimeouts.size(); ++i)
+      {
+         const NodeID nodeID = GetFirstNodeID() + mExpiredTimeouts[i];
+         if (GetNodeCurrentState(nodeID) != NetworkTopology::Disconnected && !IsNodeReserved(nodeID))
+         {
+            printf("mesh timed out node %d\n", nodeID);
+            const bool erased = mAddrToNodeID.Erase(GetNodeAddress(nodeID));
+            assert(erased);
+            (void)erased; // only checked in debug builds
+            ResetNode(nodeID);
+
+            // cheat: at this point we should disconnect the node's node, too
+            {
+               net::Node& node = net::NetworkEngine::GetRef().GetNode();
+               if (node.IsRunning() && node.IsNodeConnected(nodeID))
                {
-                  net::Node& node = net::NetworkEngine::GetRef().GetNode();
-                  if (node.IsRunning() && node.IsNodeConnected(i))
-                  {
-                     node.DisconnectNode(i, node.GetNodeAddress(i));
-                  }
+                  node.DisconnectNode(nodeID, node.GetNodeAddress(nodeID));
                }
             }
          }
@@ -255,6 +636,18 @@ namespace net {
       NetworkTopology::ClearData();
       NetworkTopology::Reserve(kMaxNodes);
       mSendAccumulator = 0.0f;
+      mMulticastAcks.assign(kMaxNodes, 0);
+      mTimeouts.CancelAll();
+      ResetTableVersions();
+
+      // the other shards should stop advertising our nodes too
+      if (mTable)
+      {
+         for (int i = 0; i < GetNumNodesReserved(); ++i)
+         {
+            mTable->SetAddress(GetFirstNodeID() + i, Address());
+         }
+      }
    }
 
 ////////////////////////////////////////////////////////////////////////////////
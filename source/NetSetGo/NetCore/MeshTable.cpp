@@ -0,0 +1,66 @@
+#include <NetSetGo/NetCore/MeshTable.h>
+
+#if defined(_MSC_VER)
+#   include <windows.h>
+#endif
+
+#include <cassert>
+
+namespace net {
+
+   static void StoreEntry(unsigned long long* entry, unsigned long long value)
+   {
+#if defined(_MSC_VER)
+      InterlockedExchange64(reinterpret_cast<volatile LONGLONG*>(entry), LONGLONG(value));
+#else
+      __atomic_store_n(entry, value, __ATOMIC_RELEASE);
+#endif
+   }
+
+   static unsigned long long LoadEntry(const unsigned long long* entry)
+   {
+#if defined(_MSC_VER)
+      volatile LONGLONG* target = reinterpret_cast<volatile LONGLONG*>(const_cast<unsigned long long*>(entry));
+      return (unsigned long long)InterlockedCompareExchange64(target, 0, 0);
+#else
+      return __atomic_load_n(entry, __ATOMIC_ACQUIRE);
+#endif
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   MeshTable::MeshTable(int numNodes)
+      : mNumNodes(numNodes)
+      , mEntries(NULL)
+   {
+      assert(mNumNodes >= 1);
+      mEntries = new unsigned long long[mNumNodes];
+      for (int i = 0; i < mNumNodes; ++i)
+      {
+         mEntries[i] = 0;
+      }
+   }
+
+   MeshTable::~MeshTable()
+   {
+      delete [] mEntries;
+      mEntries = NULL;
+   }
+
+   void MeshTable::SetAddress(NodeID nodeID, const Address& address)
+   {
+      assert(nodeID >= 0 && nodeID < mNumNodes);
+      const unsigned long long value = ((unsigned long long)address.GetAddress() << 16) | address.GetPort();
+      StoreEntry(&mEntries[nodeID], value);
+   }
+
+   Address MeshTable::GetAddress(NodeID nodeID) const
+   {
+      assert(nodeID >= 0 && nodeID < mNumNodes);
+      const unsigned long long value = LoadEntry(&mEntries[nodeID]);
+      return Address((unsigned int)(value >> 16), (unsigned short)(value & 0xFFFF));
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -6,9 +6,19 @@
 #   include <WinSock2.h>
 #else
 #   include <netdb.h>
+#   include <unistd.h>
 #   define SOCKET_ERROR -1
 #endif
 
+#if NET_PLATFORM == NET_PLATFORM_UNIX && defined(__linux__)
+#   include <sched.h>
+#   define NET_ENGINE_AFFINITY 1 // threads can be pinned to a core
+#else
+#   define NET_ENGINE_AFFINITY 0
+#endif
+
+#include <stdio.h>
+
 net::NetworkEngine* net::NetworkEngine::sgSelf = 0;
 
 namespace net {
@@ -99,6 +109,12 @@ void NetworkEngine::StopAdvertising()
 ////////////////////////////////////////////////////////////////////////////////
 void NetworkEngine::Update(float deltaTime)
 {
+   if (mLowLatency && !mPinTried && mLowLatencyProfile.mCpu >= 0)
+   {
+      mPinTried = true;
+      mPinned = PinThread(mLowLatencyProfile.mCpu);
+   }
+
    if (mBeaconTransmitter.IsRunning())
    {
       mBeaconTransmitter.Update(deltaTime);
@@ -115,6 +131,132 @@ void NetworkEngine::Update(float deltaTime)
    }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+bool NetworkEngine::WaitForWork(float maxWait)
+{
+   // never sleep past the next time Update() has something to do
+   float timeout = maxWait;
+   if (mBeaconTransmitter.IsRunning())
+   {
+      const float timeUntilBeacon = mBeaconTransmitter.GetTimeUntilNextBeacon();
+      timeout = (timeout < 0.0f || timeUntilBeacon < timeout) ? timeUntilBeacon : timeout;
+   }
+   if (mNode.IsRunning())
+   {
+      const float timeUntilDeadline = mNode.GetTimeUntilNextDeadline();
+      timeout = (timeout < 0.0f || timeUntilDeadline < timeout) ? timeUntilDeadline : timeout;
+   }
+   if (mMesh.IsRunning())
+   {
+      const float timeUntilDeadline = mMesh.GetTimeUntilNextDeadline();
+      timeout = (timeout < 0.0f || timeUntilDeadline < timeout) ? timeUntilDeadline : timeout;
+   }
+
+   std::vector<const Socket*> sockets;
+   mNode.GetSockets(sockets);
+   mMesh.GetSockets(sockets);
+   sockets.push_back(&mBeaconTransmitter.GetSocket());
+
+   if (mLowLatency && mLowLatencyProfile.mSpinTime > 0.0f && timeout != 0.0f)
+   {
+      // keep checking, without sleeping, until the spin budget or the timeout runs out
+      const float spinTime = (timeout < 0.0f || mLowLatencyProfile.mSpinTime < timeout) ? mLowLatencyProfile.mSpinTime : timeout;
+      const double start = Socket::GetTime();
+      float spun = 0.0f;
+      do
+      {
+         if (mPoller.Wait(&sockets[0], int(sockets.size()), 0.0f))
+         {
+            ++mSpinWakeups;
+            return true;
+         }
+         spun = float(Socket::GetTime() - start);
+      }
+      while (spun < spinTime);
+
+      ++mSleepWakeups;
+      if (timeout > 0.0f)
+      {
+         timeout = spun < timeout ? timeout - spun : 0.0f;
+      }
+   }
+
+   const bool readable = mPoller.Wait(&sockets[0], int(sockets.size()), timeout);
+   return readable;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NetworkEngine::LowLatencyProfile::LowLatencyProfile()
+   : mBusyPollTime(50)
+   , mCpu(-1)
+   , mSpinTime(0.0001f)
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NetworkEngine::SetLowLatencyProfile(const LowLatencyProfile& profile)
+{
+   mLowLatency = true;
+   mLowLatencyProfile = profile;
+   mPinTried = false;
+   mSpinWakeups = 0;
+   mSleepWakeups = 0;
+
+   mNode.SetBusyPoll(profile.mBusyPollTime);
+   mMesh.SetBusyPoll(profile.mBusyPollTime);
+   mDispatchLatencies.Reset();
+   mNode.SetDispatchLatencySampler(&mDispatchLatencies);
+   mMesh.SetDispatchLatencySampler(&mDispatchLatencies);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void NetworkEngine::ClearLowLatencyProfile()
+{
+   mLowLatency = false;
+   mNode.SetBusyPoll(0);
+   mMesh.SetBusyPoll(0);
+   mNode.SetDispatchLatencySampler(NULL);
+   mMesh.SetDispatchLatencySampler(NULL);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+NetworkEngine::LowLatencyReport NetworkEngine::GetLowLatencyReport() const
+{
+   LowLatencyReport report;
+   report.mBusyPolling = (mNode.IsRunning() && mNode.GetSocket().UsesBusyPoll())
+      || (mMesh.IsRunning() && mMesh.GetSocket().UsesBusyPoll());
+   report.mPinned = mPinned;
+   report.mSpinWakeups = mSpinWakeups;
+   report.mSleepWakeups = mSleepWakeups;
+   report.mNumSamples = mDispatchLatencies.GetNumSamples();
+   report.mDispatchLatency50 = mDispatchLatencies.GetPercentile(50.0f);
+   report.mDispatchLatency99 = mDispatchLatencies.GetPercentile(99.0f);
+   return report;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool NetworkEngine::PinThread(int cpu)
+{
+#if NET_ENGINE_AFFINITY
+   if (cpu < CPU_SETSIZE)
+   {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(cpu, &cpus);
+      if (sched_setaffinity(0, sizeof(cpus), &cpus) == 0) // 0 being the calling thread
+      {
+         return true;
+      }
+   }
+   printf("failed to pin thread to cpu %d\n", cpu);
+   return false;
+#else
+   (void)cpu;
+   printf("pinning threads is not supported on this platform\n");
+   return false;
+#endif
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 NetworkEngine::NetworkEngine()
    : mAcceptConnection(false)
@@ -122,6 +264,11 @@ NetworkEngine::NetworkEngine()
    , mBeaconTransmitter(NULL)
    , mNode(1234)
    , mMesh(1234)
+   , mLowLatency(false)
+   , mPinTried(false)
+   , mPinned(false)
+   , mSpinWakeups(0)
+   , mSleepWakeups(0)
 {
 #if NET_PLATFORM == NET_PLATFORM_WINDOWS
    const bool success = net::InitializeSockets();
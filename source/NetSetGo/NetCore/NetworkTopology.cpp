@@ -4,10 +4,8 @@
 #include <stdio.h>
 #include <cstring>
 #include <cstdlib>
-#if NET_PLATFORM == NET_PLATFORM_WINDOWS
-#   include <malloc.h>
-#endif
 
+#include <NetSetGo/NetCore/Bits.h>
 #include <NetSetGo/NetCore/netassert.h>
 #include <NetSetGo/NetCore/PacketParser.h>
 #include <NetSetGo/NetCore/Serialization.h>
@@ -17,51 +15,52 @@ namespace net {
    // reliability header is composed of 4 ints
    const int NetworkTopology::kHeaderSize = 4*sizeof(int);
 
+   // maximum number of datagrams pulled off the socket per system call
+   static const int kReceiveBatchSize = 32;
+   static const int kCoalescedBatchSize = 8; // each one may be up to 64KB
+   static const int kMaxCoalescedSize = 65536;
+
+   // number of received packets that can be held at once, be they in the middle
+   // of a batch or waiting on the application; once all are taken, further
+   // datagrams are still read and their headers seen to, but what they carry
+   // for the application is dropped until some are let go
+   static const int kPacketPoolSize = 256;
+
+   // a peer socket only ever hears from its peer, so io_uring and receive
+   // offload would cost more than they save there
+   static const int kPeerSocketOptions = Socket::NonBlocking | Socket::AllowMultiBind | Socket::Timestamps | Socket::AutoTuneBuffers;
+
+   // a multicast group's port is shared by everyone on this host hearing it
+   static const int kMulticastSocketOptions = Socket::NonBlocking | Socket::AllowMultiBind;
+   static const int kMaxMulticastSize = 65536;
+
+   // for the list of active nodes
+   static const int kEndOfList = -1;
+   static const int kNotListed = -2;
+
 ////////////////////////////////////////////////////////////////////////////////
 
    NetworkTopology::NodeState::NodeState()
-      : mAddress(Address())
-      , mPreviousState(Disconnected)
-      , mCurrentState(Disconnected)
-      , mGuaranteedDeliverySystem(mReliabilitySystem)
+      : mGuaranteedDeliverySystem(mReliabilitySystem)
       , mTransmissionDelayAccumulator(0.0f)
-      , mTimeoutAccumulator(0.0f)
-      , mReserved(false)
    {
    }
 
-   void NetworkTopology::NodeState::Reset(bool resetState)
+   void NetworkTopology::NodeState::Reset()
    {
       printf("resetting NodeState\n");
-      mAddress                      = Address();
-      if (resetState)
-      {
-         mPreviousState             = Disconnected;
-         mCurrentState              = Disconnected;
-      }
       mReliabilitySystem.Reset();
       mFlowControl.Reset();
       mGuaranteedDeliverySystem.Reset();
       mTransmissionDelayAccumulator = 0.0f;
-      mTimeoutAccumulator           = 0.0f;
-      mReserved                     = false;
    }
 
    void NetworkTopology::NodeState::Update(float deltaTime)
    {
-      mPreviousState = mCurrentState;
-
       // update flow control
-      if (mCurrentState == Connected)
-      {
-         mReliabilitySystem.Update(deltaTime);
-         mGuaranteedDeliverySystem.Update();
-         mFlowControl.Update(deltaTime, mReliabilitySystem.GetRoundTripTime() * 1000.0f);
-      }
-      else
-      {
-         mTransmissionDelayAccumulator = 0.0f;
-      }
+      mReliabilitySystem.Update(deltaTime);
+      mGuaranteedDeliverySystem.Update();
+      mFlowControl.Update(deltaTime, mReliabilitySystem.GetRoundTripTime() * 1000.0f);
    }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -73,9 +72,20 @@ namespace net {
       , mSendAccumulator(0.0f)
       //
       , mRunning(false)
-      , mSocket(Socket::NonBlocking | Socket::Broadcast)
+      , mSocket(Socket::NonBlocking | Socket::Broadcast | Socket::IoUring | Socket::ReceiveOffload | Socket::Timestamps | Socket::AutoTuneBuffers)
+      , mTransport(&mSocket)
       , mMaxPacketSize(maxPacketSize)
       , mPacketParser(packetParser)
+      , mBatchSends(false)
+      , mConnectPeers(false)
+      , mFirstNodeID(0)
+      , mNodeStates(NULL)
+      , mFirstActiveNode(kEndOfList)
+      , mLastActiveNode(kEndOfList)
+      , mNumActiveNodes(0)
+      , mPacketPool(kHeaderSize + maxPacketSize, kPacketPoolSize)
+      , mDispatchLatencySampler(NULL)
+      , mMulticastSocket(kMulticastSocketOptions)
    {
       assert(mPacketParser);
    }
@@ -102,13 +112,47 @@ namespace net {
       return maxGuaranteedPacketPayloadSize;
    }
 
+   void NetworkTopology::SetMaxPacketSize(int maxPacketSize)
+   {
+      const bool resized = mPacketPool.Resize(kHeaderSize + maxPacketSize);
+      netassert(resized);
+      if (resized)
+      {
+         mMaxPacketSize = maxPacketSize;
+      }
+   }
+
+   void NetworkTopology::SetTransport(Transport* transport)
+   {
+      netassert(!IsRunning());
+      if (!IsRunning())
+      {
+         mTransport = transport ? transport : &mSocket;
+      }
+   }
+
+   void NetworkTopology::SetBusyPoll(int microseconds)
+   {
+      const int options = mSocket.GetOptions() & ~Socket::BusyPoll;
+      mSocket.SetOptions(microseconds > 0 ? (options | Socket::BusyPoll) : options);
+      mSocket.SetBusyPollTime(microseconds);
+   }
+
    bool NetworkTopology::Start(int port)
    {
       netassert(!IsRunning());
 
       if (!IsRunning())
       {
-         mRunning = mSocket.Open(port);
+         if (mConnectPeers)
+         {
+            AddSocketOptions(Socket::AllowMultiBind); // so the peer sockets can share the port
+         }
+         mRunning = mTransport->Open(port);
+         for (size_t i = 0; i < mPeerSockets.size() && IsRunning(); ++i)
+         {
+            OpenPeerSocket(i);
+         }
       }
 
       printf("start NetworkTopology on port %d: %s\n", port, IsRunning() ? "success" : "failure");
@@ -121,32 +165,101 @@ namespace net {
       if (IsRunning())
       {
          printf("stop NetworkTopology\n");
-         mSocket.Close();
+         FlushPackets();
+         for (size_t i = 0; i < mPeerSockets.size(); ++i)
+         {
+            mPeerSockets[i]->Close();
+         }
+         UnsubscribeMulticast();
+         mTransport->Close();
          mRunning = false;
       }
    }
 
    void NetworkTopology::Update(float deltaTime)
    {
-      // update all connected nodes
-      for (size_t i = 0; i < mNodes.size(); ++i)
+      // update all connected nodes; the free ones aren't looked at, and
+      // those that disconnected since last time are now done with
+      int index = mFirstActiveNode;
+      while (index != kEndOfList)
       {
-         assert(mNodes[i]);
-         mNodes[i]->Update(deltaTime);
+         const int next = mNextActiveNodes[index];
+         mPreviousStates[index] = mCurrentStates[index];
+         if (mCurrentStates[index] == Connected)
+         {
+            mNodes[index]->Update(deltaTime);
+         }
+         else if (mCurrentStates[index] == Disconnected)
+         {
+            UnlinkActiveNode(index);
+         }
+         index = next;
+      }
+   }
+
+   void NetworkTopology::GetSockets(std::vector<const Socket*>& sockets) const
+   {
+      sockets.push_back(&mSocket);
+      for (size_t i = 0; i < mPeerSockets.size(); ++i)
+      {
+         if (mPeerSockets[i]->IsOpen())
+         {
+            sockets.push_back(mPeerSockets[i]);
+         }
       }
+      if (mMulticastSocket.IsOpen())
+      {
+         sockets.push_back(&mMulticastSocket);
+      }
+   }
+
+   float NetworkTopology::GetTimeUntilNextDeadline() const
+   {
+      const float timeUntilSend = mSendRate - mSendAccumulator;
+      return timeUntilSend > 0.0f ? timeUntilSend : 0.0f;
    }
 
    bool NetworkTopology::MulticastPacket(const net::Address& destination, const unsigned char data[], int size)
    {
-      const bool success = destination.IsMulticastAddress() && mSocket.Send(destination, data, size);
+      const bool success = destination.IsMulticastAddress() && mTransport->Send(destination, data, size);
       return success;
    }
 
+   bool NetworkTopology::SubscribeMulticast(const net::Address& group)
+   {
+      if (!IsRunning() || !group.IsMulticastAddress())
+      {
+         return false;
+      }
+
+      UnsubscribeMulticast();
+      if (!mMulticastSocket.Open(group.GetPort()) || !mMulticastSocket.Subscribe(group))
+      {
+         printf("failed to subscribe to multicast group %d.%d.%d.%d:%d\n",
+            group.GetA(), group.GetB(), group.GetC(), group.GetD(), group.GetPort());
+         mMulticastSocket.Close();
+         return false;
+      }
+      mMulticastGroup = group;
+      return true;
+   }
+
+   void NetworkTopology::UnsubscribeMulticast()
+   {
+      if (mMulticastSocket.IsOpen())
+      {
+         mMulticastSocket.Unsubscribe(mMulticastGroup);
+         mMulticastSocket.Close();
+      }
+      mMulticastGroup = Address();
+   }
+
    bool NetworkTopology::WasNodeConnected(NodeID nodeId) const
    {
       assert(nodeId >= 0);
-      const bool wasConnected = nodeId < int(mNodes.size())
-         ? mNodes[int(nodeId)]->mPreviousState == Connected
+      const int index = int(nodeId - mFirstNodeID);
+      const bool wasConnected = nodeId >= mFirstNodeID && index < GetNumNodesReserved()
+         ? mPreviousStates[index] == Connected
          : false;
       return wasConnected;
    }
@@ -154,8 +267,9 @@ namespace net {
    bool NetworkTopology::IsNodeConnected(NodeID nodeId) const
    {
       assert(nodeId >= 0);
-      const bool isConnected = nodeId < int(mNodes.size())
-         ? mNodes[int(nodeId)]->mCurrentState == Connected
+      const int index = int(nodeId - mFirstNodeID);
+      const bool isConnected = nodeId >= mFirstNodeID && index < GetNumNodesReserved()
+         ? mCurrentStates[index] == Connected
          : false;
       return isConnected;
    }
@@ -163,67 +277,52 @@ namespace net {
    void NetworkTopology::ConnectNode(NodeID nodeID, const Address& address)
    {
       assert(nodeID > NODEID_INVALID);
-      assert(nodeID < NodeID(mNodes.size()));
 
-      NodeState* node = GetNodeByID(nodeID);
-      assert(node);
-      if (address != node->mAddress)
+      assert(GetNodeByID(nodeID));
+      if (address != GetNodeAddress(nodeID))
       {
          printf("%s: node %d @ %d.%d.%d.%d:%d connected\n", GetIdentity().c_str(), nodeID,
             address.GetA(), address.GetB(), address.GetC(), address.GetD(), address.GetPort());
-         node->mCurrentState    = Connected;
-         node->mAddress         = address;
-         node->mReserved        = true;
-         mAddrToNodeID[address] = nodeID;
+         DisconnectPeer(GetNodeAddress(nodeID)); // in case the node moved
+         SetNodeCurrentState(nodeID, Connected);
+         SetNodeAddress(nodeID, address);
+         SetNodeReserved(nodeID, true);
+         mAddrToNodeID.Insert(address, nodeID);
       }
    }
 
    void NetworkTopology::DisconnectNode(NodeID nodeID, const Address& address)
    {
-      NodeState* node = GetNodeByID(nodeID);
-      if (node->mCurrentState)
+      if (GetNodeCurrentState(nodeID))
       {
          printf("%s: node %d disconnected\n", GetIdentity().c_str(), nodeID);
-         AddrToNodeID::iterator itor = mAddrToNodeID.find(node->mAddress);
-         if (itor != mAddrToNodeID.end())
-         {
-            mAddrToNodeID.erase(itor);
-         }
-         node->mCurrentState = Disconnected;
-         node->mAddress = Address();
+         mAddrToNodeID.Erase(GetNodeAddress(nodeID));
+         DisconnectPeer(GetNodeAddress(nodeID));
+         SetNodeCurrentState(nodeID, Disconnected);
 
          // reset everything but node state
-         node->Reset(false);
+         ResetNode(nodeID, false);
       }
    }
 
    const Address& NetworkTopology::GetNodeAddress(NodeID nodeId) const
    {
-      assert(nodeId > NODEID_INVALID);
-      assert(nodeId < NodeID(mNodes.size()));
-      const Address& address = mNodes[int(nodeId)]->mAddress;
+      assert(GetNodeByID(nodeId));
+      const Address& address = mAddresses[nodeId - mFirstNodeID];
       return address;
    }
 
    NodeID NetworkTopology::GetNodeIDFromAddress(const Address& address) const
    {
-      NodeID nodeID = NODEID_INVALID;
-
-      AddrToNodeID::const_iterator itor = mAddrToNodeID.find(address);
-      if (itor != mAddrToNodeID.end())
-      {
-         nodeID = itor->second;
-      }
-
-      return nodeID;
+      return mAddrToNodeID.Find(address);
    }
 
    NetworkTopology::NodeState* NetworkTopology::GetNodeByID(NodeID nodeID)
    {
       NodeState* node = 0;
-      if (nodeID > NODEID_INVALID && int(nodeID) < GetNumNodesReserved())
+      if (nodeID >= mFirstNodeID && int(nodeID - mFirstNodeID) < GetNumNodesReserved())
       {
-         node = mNodes[int(nodeID)];
+         node = mNodes[int(nodeID - mFirstNodeID)];
       }
       return node;
    }
@@ -231,9 +330,9 @@ namespace net {
    const NetworkTopology::NodeState* NetworkTopology::GetNodeByID(NodeID nodeID) const
    {
       const NodeState* node = 0;
-      if (nodeID > NODEID_INVALID && int(nodeID) < GetNumNodesReserved())
+      if (nodeID >= mFirstNodeID && int(nodeID - mFirstNodeID) < GetNumNodesReserved())
       {
-         node = mNodes[int(nodeID)];
+         node = mNodes[int(nodeID - mFirstNodeID)];
       }
       return node;
    }
@@ -243,26 +342,109 @@ namespace net {
       return mNodes;
    }
 
+   NodeID NetworkTopology::GetFirstActiveNode() const
+   {
+      return mFirstActiveNode != kEndOfList ? mFirstNodeID + mFirstActiveNode : NODEID_INVALID;
+   }
+
+   NodeID NetworkTopology::GetNextActiveNode(NodeID nodeID) const
+   {
+      const int index = int(nodeID - mFirstNodeID);
+      assert(index >= 0 && index < GetNumNodesReserved());
+      assert(mPrevActiveNodes[index] != kNotListed);
+      const int next = mNextActiveNodes[index];
+      return next != kEndOfList ? mFirstNodeID + next : NODEID_INVALID;
+   }
+
+   NodeID NetworkTopology::FindFirstFreeNode() const
+   {
+      for (size_t i = 0; i < mFreeNodes.size(); ++i)
+      {
+         if (mFreeNodes[i])
+         {
+            return mFirstNodeID + NodeID(i * 32 + LowestBit(mFreeNodes[i]));
+         }
+      }
+      return NODEID_INVALID;
+   }
+
    void NetworkTopology::Reserve(int numNodes)
    {
-      const size_t prevSize = mNodes.size();
+      assert(numNodes >= 0);
 
-      // free all the nodes we're losing
-      for (size_t i = numNodes; i < prevSize; ++i)
+      // the NodeStates are made in one block, so they can't be moved into a
+      // bigger one; they are made afresh instead
+      if (size_t(numNodes) != mNodes.size())
       {
-         delete mNodes[i];
+         delete[] mNodeStates;
+         mNodeStates = numNodes > 0 ? new NodeState[numNodes] : NULL;
+         mNodes.resize(numNodes);
+         for (int i = 0; i < numNodes; ++i)
+         {
+            mNodes[i] = &mNodeStates[i];
+         }
       }
 
-      // resize
-      mNodes.resize(numNodes);
+      // whereas what we're keeping of the rest stays
+      mPreviousStates.resize(numNodes, Disconnected);
+      mCurrentStates.resize(numNodes, Disconnected);
+      mAddresses.resize(numNodes, Address());
+      mReserved.resize(numNodes, 0);
+
+      // and the active list and the free bits are made up again from them
+      mNextActiveNodes.assign(numNodes, kNotListed);
+      mPrevActiveNodes.assign(numNodes, kNotListed);
+      mFirstActiveNode = kEndOfList;
+      mLastActiveNode = kEndOfList;
+      mNumActiveNodes = 0;
+      mFreeNodes.assign((numNodes + 31) / 32, 0);
+      for (int i = 0; i < numNodes; ++i)
+      {
+         if (mCurrentStates[i] == Disconnected)
+         {
+            mFreeNodes[i / 32] |= 1u << (i % 32);
+         }
+         if (mCurrentStates[i] != Disconnected || mPreviousStates[i] != Disconnected)
+         {
+            LinkActiveNode(i);
+         }
+      }
+   }
 
-      // allocate all the nodes we're gaining
-      for (int i = prevSize; i < numNodes; ++i)
+   void NetworkTopology::SetNodeCurrentState(NodeID nodeID, State state)
+   {
+      const int index = int(nodeID - mFirstNodeID);
+      assert(index >= 0 && index < GetNumNodesReserved());
+      mCurrentStates[index] = state;
+      if (state == Disconnected)
+      {
+         // it stays on the active list until Update() has seen it go
+         mFreeNodes[index / 32] |= 1u << (index % 32);
+      }
+      else
       {
-         mNodes[i] = new NodeState();
+         mFreeNodes[index / 32] &= ~(1u << (index % 32));
+         if (mPrevActiveNodes[index] == kNotListed)
+         {
+            LinkActiveNode(index);
+         }
       }
    }
 
+   void NetworkTopology::ResetNode(NodeID nodeID, bool resetState)
+   {
+      NodeState* node = GetNodeByID(nodeID);
+      assert(node);
+      const int index = int(nodeID - mFirstNodeID);
+      mAddresses[index] = Address();
+      if (resetState)
+      {
+         SetNodeCurrentState(nodeID, Disconnected);
+         mPreviousStates[index] = Disconnected;
+      }
+      mReserved[index] = 0;
+      node->Reset();
+   }
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -273,8 +455,55 @@ namespace net {
          return false;
       }
 
+      if (mBatchSends)
+      {
+         return QueuePacket(destination, reliabilitySystem, data, size);
+      }
+
+      // the header is written on the stack, and goes out along with the user
+      // data straight from where the caller has it
+      unsigned char header[kHeaderSize];
+      const size_t headerSize = WriteHeader(header,
+         reliabilitySystem.GetLocalSequence(),
+         reliabilitySystem.GetRemoteSequence(),
+         reliabilitySystem.GenerateAckBits());
+
+      Transport::Buffer buffers[2];
+      buffers[0].mData = header;
+      buffers[0].mSize = int(headerSize);
+      buffers[1].mData = data;
+      buffers[1].mSize = size;
+
+      // now we can send our finalized packet
+      const double time = Socket::GetTime();
+      Transport& transport = ChooseTransport(destination);
+      const unsigned int sendDrops = transport.GetSendDrops();
+      const bool packetSent = transport.SendV(destination, buffers, size > 0 ? 2 : 1);
+      if (packetSent)
+      {
+         // inform the reliability system that we sent our packet
+         reliabilitySystem.PacketSent(size, time);
+      }
+      else if (transport.GetSendDrops() != sendDrops)
+      {
+         reliabilitySystem.PacketDropped();
+      }
+
+      // return results
+      return packetSent;
+   }
+
+   bool NetworkTopology::QueuePacket(const net::Address& destination, ReliabilitySystem& reliabilitySystem, const unsigned char data[], int size)
+   {
+      if (!IsRunning())
+      {
+         return false;
+      }
+
       // final packet size is header size + data size
-      unsigned char* packet = reinterpret_cast<unsigned char*>(alloca(kHeaderSize + size));
+      const size_t offset = mSendBuffer.size();
+      mSendBuffer.resize(offset + kHeaderSize + size);
+      unsigned char* packet = &mSendBuffer[offset];
 
       size_t bytesWritten = 0;
 
@@ -287,16 +516,99 @@ namespace net {
       // then we write the user data
       memcpy(&packet[bytesWritten], data, size); bytesWritten += size;
 
-      // now we can send our finalized packet
-      const bool packetSent = mSocket.Send(destination, packet, bytesWritten);
-      if (packetSent)
+      // the buffer may move as it grows, so only its offset is kept until flushing
+      Transport::Datagram datagram;
+      datagram.mAddress = destination;
+      datagram.mData    = NULL;
+      datagram.mSize    = int(bytesWritten);
+      mSendBatch.push_back(datagram);
+      mSendOffsets.push_back(offset);
+      mSendSequences.push_back(reliabilitySystem.GetLocalSequence());
+
+      // the next packet must get the next sequence number, so account for this one now
+      reliabilitySystem.PacketSent(size);
+
+      return true;
+   }
+
+   int NetworkTopology::FlushPackets()
+   {
+      int packetsSent = 0;
+
+      if (!mSendBatch.empty())
       {
-         // inform the reliability system that we sent our packet
-         reliabilitySystem.PacketSent(size);
+         // the packets were counted as sent when queued, but the round trip
+         // time should be measured from now; their peers may have gone since
+         const double time = Socket::GetTime();
+         for (size_t i = 0; i < mSendBatch.size(); ++i)
+         {
+            mSendBatch[i].mData = &mSendBuffer[mSendOffsets[i]];
+            ReliabilitySystem* reliabilitySystem = ChooseReliabilitySystem(mSendBatch[i].mAddress);
+            if (reliabilitySystem)
+            {
+               reliabilitySystem->StampSent(mSendSequences[i], time);
+            }
+         }
+
+         // a run of packets to one peer, all the same size but for a shorter
+         // last one, already sits back to back in the buffer, so it can go out
+         // as one segmented send; everything else goes out in batches, which
+         // are compacted down to the front of mSendBatch as we go
+         size_t batched = 0;
+         size_t first = 0;
+         while (first < mSendBatch.size())
+         {
+            const Transport::Datagram run = mSendBatch[first];
+            size_t end = first + 1;
+            while (end < mSendBatch.size() &&
+               mSendBatch[end].mAddress == run.mAddress &&
+               mSendBatch[end - 1].mSize == run.mSize &&
+               mSendBatch[end].mSize <= run.mSize)
+            {
+               assert(mSendOffsets[end] == mSendOffsets[end - 1] + mSendBatch[end - 1].mSize);
+               ++end;
+            }
+
+            if (end - first > 1)
+            {
+               // keep each peer's packets in order
+               if (batched > 0)
+               {
+                  packetsSent += mTransport->SendBatch(&mSendBatch[0], int(batched));
+                  batched = 0;
+               }
+
+               // a run has one peer, so whatever of it is dropped is put down to that peer
+               const int runSize = int(end - first - 1) * run.mSize + mSendBatch[end - 1].mSize;
+               Transport& transport = ChooseTransport(run.mAddress);
+               const unsigned int sendDrops = transport.GetSendDrops();
+               packetsSent += transport.SendSegments(run.mAddress, run.mData, runSize, run.mSize);
+               ReliabilitySystem* reliabilitySystem = ChooseReliabilitySystem(run.mAddress);
+               for (unsigned int i = sendDrops; reliabilitySystem && i < transport.GetSendDrops(); ++i)
+               {
+                  reliabilitySystem->PacketDropped();
+               }
+            }
+            else
+            {
+               mSendBatch[batched++] = run;
+            }
+
+            first = end;
+         }
+
+         if (batched > 0)
+         {
+            packetsSent += mTransport->SendBatch(&mSendBatch[0], int(batched));
+         }
+
+         mSendBuffer.clear();
+         mSendOffsets.clear();
+         mSendSequences.clear();
+         mSendBatch.clear();
       }
 
-      // return results
-      return packetSent;
+      return packetsSent;
    }
 
    size_t NetworkTopology::WriteHeader(unsigned char* header, unsigned int sequence, unsigned int ack, unsigned int ack_bits)
@@ -336,70 +648,356 @@ namespace net {
       return bytesRead;
    }
 
-   int NetworkTopology::ReceivePacket(net::Address& origin, unsigned char data[], int size)
+   size_t NetworkTopology::ProcessHeader(const net::Address& origin, const unsigned char packet[], size_t size, double time)
    {
-      const size_t maxReceiveSize = kHeaderSize + size;
-
-      unsigned char* packet = reinterpret_cast<unsigned char*>(alloca(maxReceiveSize));
-      const size_t bytesReceived = mSocket.Receive(origin, packet, maxReceiveSize);
-
-      if (bytesReceived == 0)
+      if (size <= size_t(kHeaderSize))
       {
          return 0;
       }
-      if (bytesReceived <= kHeaderSize)
+
+      unsigned int packet_sequence = 0;
+      unsigned int packet_ack      = 0;
+      unsigned int packet_ack_bits = 0;
+      const size_t bytesRead = ReadHeader(packet, packet_sequence, packet_ack, packet_ack_bits);
+      if (bytesRead == 0)
       {
          return 0;
       }
 
-      size_t bytesRead = 0;
+      // inform the reliability system
+      ReliabilitySystem* reliabilitySystem = ChooseReliabilitySystem(origin);
+      if (reliabilitySystem)
+      {
+         if (time <= 0.0)
+         {
+            time = Socket::GetTime(); // not stamped by the kernel
+         }
+         reliabilitySystem->PacketReceived(packet_sequence, size - kHeaderSize);
+         reliabilitySystem->ProcessAck(packet_ack, packet_ack_bits, time);
+      }
 
+      return bytesRead;
+   }
+
+   int NetworkTopology::ReceivePacket(net::Address& origin, unsigned char data[], int size)
+   {
+      const size_t maxReceiveSize = size_t(kHeaderSize + size) < size_t(mPacketPool.GetBufferSize())
+         ? size_t(kHeaderSize + size)
+         : size_t(mPacketPool.GetBufferSize());
+      PacketPool::Handle buffer;
+
+      Transport::Datagram datagram;
+      datagram.mData = NULL;
+      datagram.mSize = 0;
+      datagram.mSegmentSize = 0;
+      datagram.mTime = 0.0;
+      if (mTransport->ReceivesInPlace())
+      {
+         // read the packet straight out of the buffer it arrived in
+         if (mTransport->ReceiveInPlace(&datagram, 1) == 0)
+         {
+            datagram.mSize = 0;
+         }
+      }
+      else if (mTransport->UsesReceiveOffload())
       {
-         unsigned int packet_sequence = 0;
-         unsigned int packet_ack      = 0;
-         unsigned int packet_ack_bits = 0;
-         bytesRead += ReadHeader(&packet[bytesRead], packet_sequence, packet_ack, packet_ack_bits);
+         // the datagram may be coalesced, so make room for all of it
+         if (mReceiveBuffer.size() < size_t(kMaxCoalescedSize))
+         {
+            mReceiveBuffer.resize(kMaxCoalescedSize);
+         }
+         datagram.mData = &mReceiveBuffer[0];
+         datagram.mSize = kMaxCoalescedSize;
+         if (mTransport->ReceiveBatch(&datagram, 1) == 0)
+         {
+            datagram.mSize = 0;
+         }
+      }
+      else
+      {
+         // into our own buffer if the pool is spent, rather than not at all
+         buffer = mPacketPool.Acquire();
+         if (!buffer.IsValid() && mReceiveBuffer.size() < maxReceiveSize)
+         {
+            mReceiveBuffer.resize(maxReceiveSize);
+         }
+         datagram.mData = buffer.IsValid() ? buffer.GetData() : &mReceiveBuffer[0];
+         datagram.mSize = mTransport->Receive(datagram.mAddress, datagram.mData, maxReceiveSize);
+         datagram.mSegmentSize = datagram.mSize;
+      }
 
-         // inform the reliability system
-         ReliabilitySystem* reliabilitySystem = ChooseReliabilitySystem(origin);
-         if (reliabilitySystem)
+      // the first packet is the one we hand back
+      const int firstSize = datagram.mSegmentSize < datagram.mSize ? datagram.mSegmentSize : datagram.mSize;
+      size_t dataPayloadSize = 0;
+      if (firstSize > 0 && size_t(firstSize) <= maxReceiveSize)
+      {
+         origin = datagram.mAddress;
+         const unsigned char* packet = reinterpret_cast<const unsigned char*>(datagram.mData);
+         const size_t bytesRead = ProcessHeader(origin, packet, firstSize, datagram.mTime);
+         if (bytesRead > 0)
          {
-            reliabilitySystem->PacketReceived(packet_sequence, bytesReceived - kHeaderSize);
-            reliabilitySystem->ProcessAck(packet_ack, packet_ack_bits);
+            // copy the data out (the rest of the bytes read)
+            dataPayloadSize = firstSize - bytesRead;
+            memcpy(data, &packet[bytesRead], dataPayloadSize);
          }
       }
 
-      // copy the data out (the rest of the bytes read)
-      size_t bytesWritten = 0;
-      const size_t dataPayloadSize = bytesReceived - bytesRead;
-      memcpy(&data[bytesWritten], &packet[bytesRead], dataPayloadSize);
-      bytesRead    += dataPayloadSize;
-      bytesWritten += dataPayloadSize;
+      // any packets coalesced with it are parsed as ReceivePackets() would
+      if (firstSize > 0)
+      {
+         ParseSegments(datagram, firstSize);
+      }
+      mTransport->ReleaseReceived();
 
       // report the amount of data written to the buffer
-      return bytesWritten;
+      return dataPayloadSize;
    }
 
    void NetworkTopology::ReceivePackets()
    {
-      Address sender;
-      unsigned char* data = reinterpret_cast<unsigned char*>(alloca(mMaxPacketSize));
+      ReceivePackets(*mTransport);
+      for (size_t i = 0; i < mPeerSockets.size(); ++i)
+      {
+         if (mPeerSockets[i]->IsOpen())
+         {
+            ReceivePackets(*mPeerSockets[i]);
+         }
+      }
+      if (mMulticastSocket.IsOpen())
+      {
+         ReceiveMulticastPackets();
+      }
+   }
+
+   void NetworkTopology::ReceiveMulticastPackets()
+   {
+      if (mMulticastBuffer.size() < size_t(kMaxMulticastSize))
+      {
+         mMulticastBuffer.resize(kMaxMulticastSize);
+      }
 
-      while (int size = ReceivePacket(sender, data, mMaxPacketSize))
+      net::Address sender;
+      int size = 0;
+      while ((size = mMulticastSocket.Receive(sender, &mMulticastBuffer[0], kMaxMulticastSize)) > 0)
       {
-         mPacketParser->ParsePacket(sender, data, size);
+         ReceiveMulticastPacket(sender, &mMulticastBuffer[0], size);
       }
    }
 
-   void NetworkTopology::ClearData()
+   void NetworkTopology::ReceivePackets(Transport& transport)
    {
-      for (size_t i = 0; i < mNodes.size(); ++i)
+      // with io_uring (or shared memory) the packets are parsed in the buffers
+      // they arrived in, otherwise in ours; coalesced datagrams need bigger
+      // buffers than the pool's, so they get a few of their own, and anything
+      // kept is copied out of them
+      const bool inPlace = transport.ReceivesInPlace();
+      const bool coalesced = transport.UsesReceiveOffload();
+      const bool pooled = !inPlace && !coalesced;
+
+      const size_t slotSize = coalesced ? size_t(kMaxCoalescedSize) : size_t(mPacketPool.GetBufferSize());
+      const int batchSize = coalesced ? kCoalescedBatchSize : kReceiveBatchSize;
+      mReceiveBatch.resize(batchSize);
+      mReceiveHandles.resize(batchSize);
+      if (!inPlace && mReceiveBuffer.size() < slotSize * batchSize)
       {
-         assert(mNodes[i]);
-         delete mNodes[i];
+         mReceiveBuffer.resize(slotSize * batchSize);
+      }
+
+      int received = 0;
+      do
+      {
+         if (inPlace)
+         {
+            received = transport.ReceiveInPlace(&mReceiveBatch[0], batchSize);
+         }
+         else
+         {
+            for (int i = 0; i < batchSize; ++i)
+            {
+               // once the application holds every pooled buffer, the socket
+               // is still drained into our own, so acks and keep alives get
+               // through; only the payloads it would have kept are dropped
+               if (pooled)
+               {
+                  mReceiveHandles[i] = mPacketPool.Acquire();
+               }
+               mReceiveBatch[i].mData = mReceiveHandles[i].IsValid() ? mReceiveHandles[i].GetData() : &mReceiveBuffer[i * slotSize];
+               mReceiveBatch[i].mSize = int(slotSize);
+            }
+
+            received = transport.ReceiveBatch(&mReceiveBatch[0], batchSize);
+         }
+
+         // parse the payloads in place, right behind their headers
+         for (int i = 0; i < received; ++i)
+         {
+            ParseSegments(mReceiveBatch[i], 0);
+         }
+         transport.ReleaseReceived();
+
+         // buffers a parser shared stay out of the pool until it lets them go
+         for (int i = 0; i < batchSize && pooled; ++i)
+         {
+            mReceiveHandles[i].Release();
+         }
       }
-      mNodes.clear();
-      mAddrToNodeID.clear();
+      while (received == batchSize);
+   }
+
+   void NetworkTopology::ParseSegments(const Transport::Datagram& datagram, int offset)
+   {
+      // a coalesced datagram is several packets back to back, each parsed on its own
+      const size_t maxPacketSize = kHeaderSize + mMaxPacketSize;
+      const int segmentSize = datagram.mSegmentSize > 0 ? datagram.mSegmentSize : datagram.mSize;
+      const unsigned char* bytes = reinterpret_cast<const unsigned char*>(datagram.mData);
+      for (; offset < datagram.mSize; offset += segmentSize)
+      {
+         const size_t size = (datagram.mSize - offset) < segmentSize ? (datagram.mSize - offset) : segmentSize;
+         if (size > maxPacketSize)
+         {
+            continue; // too big for us, as it would have been for our own buffers
+         }
+
+         const unsigned char* packet = &bytes[offset];
+         const size_t bytesRead = ProcessHeader(datagram.mAddress, packet, size, datagram.mTime);
+         if (bytesRead > 0)
+         {
+            if (mDispatchLatencySampler && datagram.mTime > 0.0)
+            {
+               mDispatchLatencySampler->AddSample(Socket::GetTime() - datagram.mTime);
+            }
+            mPacketParser->ParsePacket(datagram.mAddress, &packet[bytesRead], size - bytesRead);
+         }
+      }
+   }
+
+   void NetworkTopology::ConnectPeer(const net::Address& address)
+   {
+      if (!mConnectPeers || address == Address())
+      {
+         return;
+      }
+
+      for (size_t i = 0; i < mPeers.size(); ++i)
+      {
+         if (mPeers[i] == address)
+         {
+            return;
+         }
+      }
+
+      mPeers.push_back(address);
+      mPeerSockets.push_back(new Socket(kPeerSocketOptions));
+      if (IsRunning())
+      {
+         OpenPeerSocket(mPeers.size() - 1);
+      }
+   }
+
+   void NetworkTopology::DisconnectPeer(const net::Address& address)
+   {
+      for (size_t i = 0; i < mPeers.size(); ++i)
+      {
+         if (mPeers[i] == address)
+         {
+            // anything still queued to it goes out through the shared socket
+            delete mPeerSockets[i];
+            mPeerSockets.erase(mPeerSockets.begin() + i);
+            mPeers.erase(mPeers.begin() + i);
+            return;
+         }
+      }
+   }
+
+   void NetworkTopology::DisconnectPeers()
+   {
+      for (size_t i = 0; i < mPeerSockets.size(); ++i)
+      {
+         delete mPeerSockets[i];
+      }
+      mPeerSockets.clear();
+      mPeers.clear();
+   }
+
+   Transport& NetworkTopology::ChooseTransport(const net::Address& destination)
+   {
+      for (size_t i = 0; i < mPeers.size(); ++i)
+      {
+         if (mPeers[i] == destination && mPeerSockets[i]->IsOpen())
+         {
+            return *mPeerSockets[i];
+         }
+      }
+      return *mTransport;
+   }
+
+   void NetworkTopology::LinkActiveNode(int index)
+   {
+      assert(mPrevActiveNodes[index] == kNotListed);
+      mPrevActiveNodes[index] = mLastActiveNode;
+      mNextActiveNodes[index] = kEndOfList;
+      if (mLastActiveNode != kEndOfList)
+      {
+         mNextActiveNodes[mLastActiveNode] = index;
+      }
+      else
+      {
+         mFirstActiveNode = index;
+      }
+      mLastActiveNode = index;
+      ++mNumActiveNodes;
+   }
+
+   void NetworkTopology::UnlinkActiveNode(int index)
+   {
+      assert(mPrevActiveNodes[index] != kNotListed);
+      const int prev = mPrevActiveNodes[index];
+      const int next = mNextActiveNodes[index];
+      if (prev != kEndOfList)
+      {
+         mNextActiveNodes[prev] = next;
+      }
+      else
+      {
+         mFirstActiveNode = next;
+      }
+      if (next != kEndOfList)
+      {
+         mPrevActiveNodes[next] = prev;
+      }
+      else
+      {
+         mLastActiveNode = prev;
+      }
+      mPrevActiveNodes[index] = kNotListed;
+      mNextActiveNodes[index] = kNotListed;
+      --mNumActiveNodes;
+   }
+
+   void NetworkTopology::OpenPeerSocket(size_t index)
+   {
+      // the peer socket has to share our port, or the peer would not know who it is hearing from
+      Socket& socket = *mPeerSockets[index];
+      socket.SetOptions(kPeerSocketOptions | (mSocket.GetOptions() & Socket::BusyPoll));
+      socket.SetBusyPollTime(mSocket.GetBusyPollTime());
+      if (mTransport == &mSocket && mSocket.GetPort() != 0 && socket.Open(mSocket.GetPort()) && !socket.Connect(mPeers[index]))
+      {
+         socket.Close();
+      }
+   }
+
+   void NetworkTopology::ClearData()
+   {
+      DisconnectPeers();
+      Reserve(0);
+      mAddrToNodeID.Clear();
+   }
+
+   void NetworkTopology::ReceiveMulticastPacket(const net::Address& sender, const unsigned char data[], int size)
+   {
+      (void)sender;
+      (void)data;
+      (void)size;
    }
 
    ReliabilitySystem* NetworkTopology::ChooseReliabilitySystem(const net::Address& nodeAddress)
@@ -7,6 +7,7 @@
 #include <cstring>
 
 #include <NetSetGo/NetCore/netassert.h>
+#include <NetSetGo/NetCore/Serialization.h>
 
 #define PRINT_OUTGOING_PACKETS 0 // commit as 0
 #define PRINT_INCOMING_PACKETS 0 // commit as 0
@@ -31,6 +32,26 @@ namespace net {
       printf(")");
    }
 
+   // reads which nodes a page of the table holds, checking they are ones we
+   // have and that their addresses fill the rest of it; returns where those
+   // start, or 0 if the page doesn't hold together
+   static size_t ReadPage(const unsigned char data[], size_t size, int numNodesReserved, NodeID& firstNodeID, int& numNodes)
+   {
+      unsigned int first = 0;
+      unsigned int count = 0;
+      const size_t firstSize = ReadVarInt(data, size, first);
+      const size_t countSize = firstSize ? ReadVarInt(&data[firstSize], size - firstSize, count) : 0;
+      const size_t position = firstSize + countSize;
+      if (countSize == 0 || count > unsigned(numNodesReserved) || first > unsigned(numNodesReserved) - count ||
+          size - position != 6 * size_t(count))
+      {
+         return 0;
+      }
+      firstNodeID = NodeID(first);
+      numNodes = int(count);
+      return position;
+   }
+
 ////////////////////////////////////////////////////////////////////////////////
 
    bool Node::NodePacketParser::ParsePacket(const Address& sender, const unsigned char data[], size_t size) const
@@ -49,16 +70,28 @@ namespace net {
          {
             return false;
          }
-         // determine packet type
-         enum PacketType { ConnectionAccepted, Update };
+         // determine packet type; a mesh with a paged table sends the
+         // first two with wider node IDs
+         enum PacketType { ConnectionAccepted, Update, Heartbeat, Delta }; // see Mesh::SendPackets()
          PacketType packetType;
-         if (data[4] == 0)
+         bool paged = false;
+         if (data[4] == 0 || data[4] == 4)
          {
             packetType = ConnectionAccepted;
+            paged = data[4] == 4;
          }
-         else if (data[4] == 1)
+         else if (data[4] == 1 || data[4] == 5)
          {
             packetType = Update;
+            paged = data[4] == 5;
+         }
+         else if (data[4] == 2)
+         {
+            packetType = Heartbeat;
+         }
+         else if (data[4] == 7)
+         {
+            packetType = Delta;
          }
          else
          {
@@ -68,49 +101,144 @@ namespace net {
          switch (packetType)
          {
          case ConnectionAccepted:
-            if (size != 7)
             {
-               return false;
-            }
-            if (mNode.GetCurrentState() == Connecting)
-            {
-               mNode.SetLocalNodeID(NodeID(data[5]));
-               mNode.Reserve(data[6]);
-               printf("node connects as node %d of %d\n", mNode.GetLocalNodeID(), mNode.GetNumNodesReserved());
-               mNode.SetCurrentState(Connected);
+               unsigned int nodeID = 0;
+               unsigned int numNodes = 0;
+               size_t position = 5;
+               if (paged)
+               {
+                  const size_t nodeIDSize = ReadVarInt(&data[position], size - position, nodeID);
+                  position += nodeIDSize;
+                  const size_t numNodesSize = nodeIDSize ? ReadVarInt(&data[position], size - position, numNodes) : 0;
+                  position = numNodesSize ? position + numNodesSize : 0;
+               }
+               else if (size >= 7)
+               {
+                  nodeID = data[5];
+                  numNodes = data[6];
+                  position = 7;
+               }
+               else
+               {
+                  position = 0;
+               }
+               // followed by the multicast group, if there is one
+               if (position == 0 || (size != position && size != position + 6) || nodeID >= numNodes)
+               {
+                  return false;
+               }
+               if (mNode.GetCurrentState() == Connecting)
+               {
+                  mNode.SetLocalNodeID(NodeID(nodeID));
+                  mNode.Reserve(int(numNodes));
+                  printf("node connects as node %d of %d\n", mNode.GetLocalNodeID(), mNode.GetNumNodesReserved());
+                  mNode.SetCurrentState(Connected);
+                  // the mesh may publish its table to a multicast group instead
+                  if (size == position + 6)
+                  {
+                     unsigned int group = 0;
+                     unsigned short port = 0;
+                     ReadInteger(&data[position], group);
+                     ReadShort(&data[position + 4], port);
+                     mNode.SubscribeMulticast(Address(group, port));
+                  }
+               }
+               mNode.ClearTimeoutAccumulator();
             }
-            mNode.ClearTimeoutAccumulator();
             break;
          case Update:
-            if (size != int(5 + mNode.GetNumNodesReserved() * 6))
             {
-               return false;
-            }
-            if (mNode.GetCurrentState() == Connected)
-            {
-               // process update packet
-               const unsigned char* ptr = &data[5];
-               for (net::NodeID nodeID = net::NodeID(0); int(nodeID) < mNode.GetNumNodesReserved(); ++nodeID)
+               if (size < 9)
+               {
+                  return false;
+               }
+               unsigned int version = 0;
+               unsigned int baseVersion = 0;
+               ReadInteger(&data[5], version);
+               NodeID firstNodeID = 0;
+               int numNodes = mNode.GetNumNodesReserved();
+               size_t position = 9;
+               if (paged)
                {
-                  unsigned char a = ptr[0];
-                  unsigned char b = ptr[1];
-                  unsigned char c = ptr[2];
-                  unsigned char d = ptr[3];
-                  unsigned short port = (unsigned short)ptr[4] << 8 | (unsigned short)ptr[5];
-                  Address address(a, b, c, d, port);
-                  NodeState* node = mNode.GetNodeByID(nodeID);
-                  if (address.GetAddress() != 0)
+                  if (size < 13)
                   {
-                     // node is connected
-                     mNode.ConnectNode(nodeID, address);
+                     return false;
                   }
-                  else
+                  position += ReadInteger(&data[position], baseVersion);
+                  const size_t pageSize = ReadPage(&data[position], size - position, mNode.GetNumNodesReserved(), firstNodeID, numNodes);
+                  position = pageSize ? position + pageSize : 0;
+               }
+               if (position == 0 || size != position + numNodes * 6)
+               {
+                  return false;
+               }
+               if (mNode.GetCurrentState() == Connected)
+               {
+                  // process update packet
+                  mNode.ReadTable(version, !paged, firstNodeID, numNodes, &data[position]);
+
+                  // a page brings us up to its version if we have the one it
+                  // follows on from, the rest of the table not having changed in between
+                  if (paged && baseVersion <= mNode.mTableVersion && version > mNode.mTableVersion)
+                  {
+                     mNode.mTableVersion = version;
+                  }
+               }
+               mNode.ClearTimeoutAccumulator();
+            }
+            break;
+         case Delta:
+            {
+               // the entries changed from one version of the table to another
+               if (size < 13)
+               {
+                  return false;
+               }
+               unsigned int baseVersion = 0;
+               unsigned int version = 0;
+               unsigned int count = 0;
+               ReadInteger(&data[5], baseVersion);
+               ReadInteger(&data[9], version);
+               const size_t countSize = ReadVarInt(&data[13], size - 13, count);
+               if (countSize == 0)
+               {
+                  return false;
+               }
+               // check it all holds together before taking any of it
+               const size_t start = 13 + countSize;
+               size_t position = start;
+               for (unsigned int i = 0; i < count && position != 0; ++i)
+               {
+                  unsigned int nodeID = 0;
+                  const size_t nodeIDSize = ReadVarInt(&data[position], size - position, nodeID);
+                  const bool valid = nodeIDSize != 0 && nodeID < unsigned(mNode.GetNumNodesReserved()) && size - position - nodeIDSize >= 6;
+                  position = valid ? position + nodeIDSize + 6 : 0;
+               }
+               if (position != size)
+               {
+                  return false;
+               }
+               // which we can if it's newer than what we have, and follows on from it
+               if (mNode.GetCurrentState() == Connected && baseVersion <= mNode.mTableVersion && version > mNode.mTableVersion)
+               {
+                  position = start;
+                  for (unsigned int i = 0; i < count; ++i)
                   {
-                     // node is not connected
-                     mNode.DisconnectNode(nodeID, address);
+                     unsigned int nodeID = 0;
+                     position += ReadVarInt(&data[position], size - position, nodeID);
+                     mNode.ReadTableEntry(NodeID(nodeID), &data[position]);
+                     position += 6;
                   }
-                  ptr += 6;
+                  mNode.mTableVersion = version;
                }
+               mNode.ClearTimeoutAccumulator();
+            }
+            break;
+         case Heartbeat:
+            // the table comes through the multicast group
+            if (size != 5)
+            {
+               return false;
             }
             mNode.ClearTimeoutAccumulator();
             break;
@@ -137,9 +265,14 @@ namespace net {
 
    Node::Node(unsigned int protocolId, float sendRate, float timeout, int maxPacketSize)
       : NetworkTopology(protocolId, new NodePacketParser(*this), sendRate, timeout, maxPacketSize)
+      , mReceivedPackets(GetPacketPool().GetNumBuffers())
+      , mFirstReceived(0)
+      , mNumReceived(0)
       , mCurrentState(Disconnected)
       , mPreviousState(Disconnected)
       , mMeshReliabilitySystem(0xFFFFFFFF) // max sequence
+      , mMulticastSequence(0)
+      , mTableVersion(0)
    {
       ClearData();
    }
@@ -157,6 +290,7 @@ namespace net {
       ClearData();
       mCurrentState = Connecting;
       mMeshAddress = address;
+      ConnectPeer(mMeshAddress);
    }
 
    void Node::Update(float deltaTime)
@@ -172,9 +306,7 @@ namespace net {
          {
             if (NodeJustDisconnected(NodeID(i)))
             {
-               NodeState* node = GetNodeByID(NodeID(i));
-               assert(node);
-               node->Reset();
+               ResetNode(NodeID(i));
             }
          }
 
@@ -193,6 +325,22 @@ namespace net {
       }
    }
 
+   float Node::GetTimeUntilNextDeadline() const
+   {
+      float timeUntilDeadline = NetworkTopology::GetTimeUntilNextDeadline();
+
+      if (GetCurrentState() == Connecting || GetCurrentState() == Connected)
+      {
+         const float timeUntilTimeout = mTimeout - mTimeoutAccumulator;
+         if (timeUntilTimeout < timeUntilDeadline)
+         {
+            timeUntilDeadline = timeUntilTimeout > 0.0f ? timeUntilTimeout : 0.0f;
+         }
+      }
+
+      return timeUntilDeadline;
+   }
+
    bool Node::SendPacket(NodeID nodeID, const unsigned char data[], int size)
    {
       netassert(IsRunning());
@@ -234,28 +382,13 @@ namespace net {
    {
       int sizeRead = 0;
 
-      assert(IsRunning());
-      if (IsRunning())
+      BufferedPacket packet;
+      if (ReceivePacket(packet) && packet.mSize <= size)
       {
-         if (!mReceivedPackets.empty())
-         {
-            BufferedPacket* packet = mReceivedPackets.front();
-            assert(packet);
-            if (int(packet->mData.size()) <= size)
-            {
-               nodeID = packet->mNodeId;
-               size = packet->mData.size();
-               memcpy(data, &packet->mData[0], size);
-               delete packet;
-               mReceivedPackets.pop();
-               sizeRead = size;
-            }
-            else
-            {
-               delete packet;
-               mReceivedPackets.pop();
-            }
-         }
+         nodeID = packet.mNodeId;
+         size = packet.mSize;
+         memcpy(data, packet.GetData(), size);
+         sizeRead = size;
       }
 
 #if PRINT_INCOMING_PACKETS
@@ -270,13 +403,56 @@ namespace net {
       return sizeRead;
    }
 
+   bool Node::ReceivePacket(BufferedPacket& packet)
+   {
+      assert(IsRunning());
+      if (!IsRunning() || mNumReceived == 0)
+      {
+         return false;
+      }
+
+      BufferedPacket& front = mReceivedPackets[mFirstReceived];
+      packet.mNodeId = front.mNodeId;
+      packet.mBuffer = front.mBuffer;
+      packet.mOffset = front.mOffset;
+      packet.mSize   = front.mSize;
+      front.mBuffer.Release();
+      mFirstReceived = (mFirstReceived + 1) % mReceivedPackets.size();
+      --mNumReceived;
+      return true;
+   }
+
    void Node::BufferPacket(NodeID nodeID, const unsigned char data[], int size)
    {
-      BufferedPacket* packet = new BufferedPacket;
-      packet->mNodeId = nodeID;
-      packet->mData.resize(size);
-      memcpy(&packet->mData[0], data, size);
-      mReceivedPackets.push(packet);
+      if (mNumReceived == mReceivedPackets.size())
+      {
+         return; // every pooled buffer is already queued up, so drop it as the socket would
+      }
+
+      // a packet received straight into the pool just keeps its buffer; one
+      // parsed where the kernel left it is copied into a buffer of its own
+      PacketPool::Handle buffer = GetPacketPool().Share(data);
+      int offset = 0;
+      if (buffer.IsValid())
+      {
+         offset = int(data - buffer.GetData());
+      }
+      else
+      {
+         buffer = GetPacketPool().Acquire();
+         if (!buffer.IsValid() || size > GetPacketPool().GetBufferSize())
+         {
+            return;
+         }
+         memcpy(buffer.GetData(), data, size);
+      }
+
+      BufferedPacket& packet = mReceivedPackets[(mFirstReceived + mNumReceived) % mReceivedPackets.size()];
+      packet.mNodeId = nodeID;
+      packet.mBuffer = buffer;
+      packet.mOffset = offset;
+      packet.mSize   = size;
+      ++mNumReceived;
    }
 
    std::string Node::GetIdentity() const
@@ -307,17 +483,22 @@ namespace net {
          }
          else if (GetCurrentState() == Connected)
          {
-            // node is connected: send "keep alive" packets
-            unsigned char packet[5];
+            // node is connected: send "keep alive" packets, with the last
+            // table heard through the multicast group, if any
+            unsigned char packet[9];
             packet[0] = (unsigned char)((mProtocolID >> 24) & 0xFF);
             packet[1] = (unsigned char)((mProtocolID >> 16) & 0xFF);
             packet[2] = (unsigned char)((mProtocolID >> 8)  & 0xFF);
             packet[3] = (unsigned char)((mProtocolID) & 0xFF);
             packet[4] = 1;
-            NetworkTopology::SendPacket(mMeshAddress, mMeshReliabilitySystem, packet, sizeof(packet));
+            WriteInteger(&packet[5], mMulticastSequence);
+            NetworkTopology::SendPacket(mMeshAddress, mMeshReliabilitySystem, packet, mMulticastSequence != 0 ? 9 : 5);
          }
          mSendAccumulator -= mSendRate;
       }
+
+      // send anything held back by SetBatchSends(), along with the above
+      FlushPackets();
    }
 
    void Node::CheckForTimeout(float deltaTime)
@@ -345,17 +526,101 @@ namespace net {
    void Node::ClearData()
    {
       NetworkTopology::ClearData();
-      while (!mReceivedPackets.empty())
+      for (size_t i = 0; i < mReceivedPackets.size(); ++i)
       {
-         BufferedPacket* packet = mReceivedPackets.front();
-         delete packet;
-         mReceivedPackets.pop();
+         mReceivedPackets[i].mBuffer.Release();
       }
+      mFirstReceived = 0;
+      mNumReceived = 0;
       mSendAccumulator = 0.0f;
       mTimeoutAccumulator = 0.0f;
       mLocalNodeID = NODEID_INVALID;
       mMeshAddress = Address();
       mMeshReliabilitySystem.Reset();
+      UnsubscribeMulticast();
+      mMulticastSequence = 0;
+      mTableVersion = 0;
+   }
+
+   void Node::ReceiveMulticastPacket(const net::Address& sender, const unsigned char data[], int size)
+   {
+      // anyone may send to the group, so only what comes from the mesh counts
+      if (GetCurrentState() != Connected || size < 13 || sender.GetAddress() != mMeshAddress.GetAddress())
+      {
+         return;
+      }
+      unsigned int protocolID = 0;
+      unsigned int sequence = 0;
+      ReadInteger(&data[0], protocolID);
+      ReadInteger(&data[5], sequence);
+      if (protocolID != mProtocolID || (data[4] != 3 && data[4] != 6) || (mMulticastSequence != 0 && int(sequence - mMulticastSequence) <= 0))
+      {
+         return; // not ours, or older than what we have
+      }
+
+      // the whole table, or a page of it
+      unsigned int version = 0;
+      ReadInteger(&data[9], version);
+      NodeID firstNodeID = 0;
+      int numNodes = GetNumNodesReserved();
+      size_t position = 13;
+      if (data[4] == 6)
+      {
+         const size_t pageSize = ReadPage(&data[position], size - position, GetNumNodesReserved(), firstNodeID, numNodes);
+         position = pageSize ? position + pageSize : 0;
+      }
+      if (position == 0 || size_t(size) != position + numNodes * 6)
+      {
+         return;
+      }
+
+      ReadTable(version, data[4] == 3, firstNodeID, numNodes, &data[position]);
+      mMulticastSequence = sequence;
+   }
+
+   void Node::ReadTable(unsigned int version, bool whole, NodeID firstNodeID, int numNodes, const unsigned char table[])
+   {
+      // a table older than ours may undo changes we have since had
+      if (version < mTableVersion)
+      {
+         return;
+      }
+
+      const unsigned char* ptr = table;
+      for (net::NodeID nodeID = firstNodeID; nodeID < firstNodeID + numNodes; ++nodeID)
+      {
+         ReadTableEntry(nodeID, ptr);
+         ptr += 6;
+      }
+
+      // whereas a page of it leaves the rest as old as it was
+      if (whole)
+      {
+         mTableVersion = version;
+      }
+   }
+
+   void Node::ReadTableEntry(NodeID nodeID, const unsigned char entry[])
+   {
+      unsigned int ip = 0;
+      unsigned short port = 0;
+      ReadInteger(&entry[0], ip);
+      ReadShort(&entry[4], port);
+      Address address(ip, port);
+      if (address.GetAddress() != 0)
+      {
+         // node is connected
+         ConnectNode(nodeID, address);
+         if (nodeID != GetLocalNodeID())
+         {
+            ConnectPeer(address);
+         }
+      }
+      else
+      {
+         // node is not connected
+         DisconnectNode(nodeID, address);
+      }
    }
 
    ReliabilitySystem* Node::ChooseReliabilitySystem(const net::Address& nodeAddress)
@@ -0,0 +1,157 @@
+#include <NetSetGo/NetCore/PacketPool.h>
+
+#include <cassert>
+#include <cstddef>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   PacketPool::Handle::Handle()
+      : mPool(NULL)
+      , mBuffer(-1)
+   {
+   }
+
+   PacketPool::Handle::Handle(PacketPool* pool, int buffer)
+      : mPool(pool)
+      , mBuffer(buffer)
+   {
+      mPool->AddRef(mBuffer);
+   }
+
+   PacketPool::Handle::Handle(const Handle& other)
+      : mPool(other.mPool)
+      , mBuffer(other.mBuffer)
+   {
+      if (mPool)
+      {
+         mPool->AddRef(mBuffer);
+      }
+   }
+
+   PacketPool::Handle::~Handle()
+   {
+      Release();
+   }
+
+   PacketPool::Handle& PacketPool::Handle::operator=(const Handle& other)
+   {
+      // take the new reference first, in case both refer to the same buffer
+      if (other.mPool)
+      {
+         other.mPool->AddRef(other.mBuffer);
+      }
+      Release();
+      mPool   = other.mPool;
+      mBuffer = other.mBuffer;
+      return *this;
+   }
+
+   unsigned char* PacketPool::Handle::GetData() const
+   {
+      return mPool ? &mPool->mBuffers[size_t(mBuffer) * mPool->mBufferSize] : NULL;
+   }
+
+   void PacketPool::Handle::Release()
+   {
+      if (mPool)
+      {
+         mPool->Release(mBuffer);
+         mPool   = NULL;
+         mBuffer = -1;
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   PacketPool::PacketPool(int bufferSize, int numBuffers)
+      : mBufferSize(bufferSize)
+      , mBuffers(NULL)
+      , mRefCounts(numBuffers, 0)
+   {
+      assert(mBufferSize > 0);
+      assert(numBuffers > 0);
+      mBuffers = new unsigned char[size_t(mBufferSize) * numBuffers];
+
+      // hand out the low buffers first
+      mFree.reserve(numBuffers);
+      for (int i = numBuffers - 1; i >= 0; --i)
+      {
+         mFree.push_back(i);
+      }
+   }
+
+   PacketPool::~PacketPool()
+   {
+      assert(GetNumFree() == GetNumBuffers()); // a Handle has outlived its pool
+      delete [] mBuffers;
+      mBuffers = NULL;
+   }
+
+   bool PacketPool::Resize(int bufferSize)
+   {
+      assert(bufferSize > 0);
+      if (bufferSize == mBufferSize)
+      {
+         return true;
+      }
+      if (GetNumFree() != GetNumBuffers())
+      {
+         return false;
+      }
+
+      delete [] mBuffers;
+      mBufferSize = bufferSize;
+      mBuffers = new unsigned char[size_t(mBufferSize) * GetNumBuffers()];
+      return true;
+   }
+
+   PacketPool::Handle PacketPool::Acquire()
+   {
+      if (mFree.empty())
+      {
+         return Handle();
+      }
+
+      const int buffer = mFree.back();
+      mFree.pop_back();
+      return Handle(this, buffer);
+   }
+
+   PacketPool::Handle PacketPool::Share(const unsigned char* data)
+   {
+      const unsigned char* end = &mBuffers[size_t(mBufferSize) * GetNumBuffers()];
+      if (data < mBuffers || data >= end)
+      {
+         return Handle();
+      }
+
+      const int buffer = int((data - mBuffers) / mBufferSize);
+      if (mRefCounts[buffer] == 0)
+      {
+         return Handle();
+      }
+
+      return Handle(this, buffer);
+   }
+
+   void PacketPool::AddRef(int buffer)
+   {
+      assert(buffer >= 0 && buffer < GetNumBuffers());
+      ++mRefCounts[buffer];
+   }
+
+   void PacketPool::Release(int buffer)
+   {
+      assert(buffer >= 0 && buffer < GetNumBuffers());
+      assert(mRefCounts[buffer] > 0);
+      if (--mRefCounts[buffer] == 0)
+      {
+         mFree.push_back(buffer);
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
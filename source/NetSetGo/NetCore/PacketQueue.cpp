@@ -4,22 +4,19 @@
 
 namespace net {
 
-   inline bool sequence_more_recent(unsigned int s1, unsigned int s2, unsigned int max_sequence)
-   {
-      return (s1 > s2) && (s1 - s2 <= max_sequence/2) || (s2 > s1) && (s2 - s1 > max_sequence/2);
-   }
-
 ////////////////////////////////////////////////////////////////////////////////
 
    PacketData::PacketData()
+      : mStamp(0.0)
    {
       //
    }
 
-   PacketData::PacketData(unsigned int sequence, float time, int size)
+   PacketData::PacketData(unsigned int sequence, double time, int size)
       : mSequence(sequence)
-      , mTime(time)
       , mSize(size)
+      , mTime(time)
+      , mStamp(0.0)
    {
       //
    }
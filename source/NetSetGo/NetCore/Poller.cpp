@@ -0,0 +1,240 @@
+#include <NetSetGo/NetCore/Poller.h>
+#include <NetSetGo/NetCore/IoUringQueue.h>
+
+#if NET_PLATFORM == NET_PLATFORM_WINDOWS
+#   include <WinSock2.h>
+#else
+#   include <sys/select.h>
+#   include <unistd.h>
+#endif
+
+#if NET_PLATFORM == NET_PLATFORM_UNIX && defined(__linux__)
+#   define NET_POLLER_EPOLL 1 // epoll and timerfd are available
+#   include <sys/epoll.h>
+#   include <sys/timerfd.h>
+#   include <errno.h>
+#else
+#   define NET_POLLER_EPOLL 0
+#endif
+
+#include <cassert>
+#include <cstring>
+#include <stdio.h>
+
+#if NET_PLATFORM == NET_PLATFORM_WINDOWS
+typedef SOCKET SocketInternalType;
+#else
+typedef int SocketInternalType;
+#endif
+
+namespace net {
+
+   // the timer is told apart from sockets by this tag in the epoll event data
+   static const int kTimerTag = -1;
+
+////////////////////////////////////////////////////////////////////////////////
+
+   Poller::Poller()
+      : mEpoll(-1)
+      , mTimer(-1)
+   {
+#if NET_POLLER_EPOLL
+      mEpoll = epoll_create1(EPOLL_CLOEXEC);
+      mTimer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+      if (mEpoll < 0 || mTimer < 0)
+      {
+         printf("failed to create poller\n");
+      }
+      else
+      {
+         epoll_event event;
+         memset(&event, 0, sizeof(event));
+         event.events = EPOLLIN;
+         event.data.fd = kTimerTag;
+         epoll_ctl(mEpoll, EPOLL_CTL_ADD, mTimer, &event);
+      }
+#endif
+   }
+
+   Poller::~Poller()
+   {
+#if NET_POLLER_EPOLL
+      if (mTimer >= 0)
+      {
+         close(mTimer);
+      }
+      if (mEpoll >= 0)
+      {
+         close(mEpoll);
+      }
+#endif
+   }
+
+   bool Poller::Wait(const Socket* const sockets[], int count, float timeout)
+   {
+      bool readable = false;
+
+      // anything io_uring has already taken off a socket is ready right now
+      for (int i = 0; i < count; ++i)
+      {
+         if (sockets[i] && sockets[i]->mQueue && sockets[i]->mQueue->HasCompletions())
+         {
+            return true;
+         }
+      }
+
+#if NET_POLLER_EPOLL
+      if (mEpoll < 0 || mTimer < 0)
+      {
+         return false;
+      }
+
+      Watch(sockets, count);
+
+      // arm the timer (or disarm it, for an indefinite wait)
+      int epollTimeout = -1;
+      if (timeout == 0.0f)
+      {
+         epollTimeout = 0;
+      }
+      else
+      {
+         itimerspec expiry;
+         memset(&expiry, 0, sizeof(expiry));
+         if (timeout > 0.0f)
+         {
+            const long nanoseconds = long(double(timeout) * 1000000000.0);
+            expiry.it_value.tv_sec  = nanoseconds / 1000000000L;
+            expiry.it_value.tv_nsec = nanoseconds % 1000000000L;
+            if (expiry.it_value.tv_sec == 0 && expiry.it_value.tv_nsec == 0)
+            {
+               expiry.it_value.tv_nsec = 1; // all zeroes would disarm the timer
+            }
+         }
+         timerfd_settime(mTimer, 0, &expiry, NULL);
+      }
+
+      const int kMaxEvents = 8;
+      epoll_event events[kMaxEvents];
+      const int numEvents = epoll_wait(mEpoll, events, kMaxEvents, epollTimeout);
+      for (int i = 0; i < numEvents; ++i)
+      {
+         if (events[i].data.fd == kTimerTag)
+         {
+            unsigned long long expirations;
+            const ssize_t bytesRead = read(mTimer, &expirations, sizeof(expirations));
+            (void)bytesRead;
+         }
+         else
+         {
+            readable = true;
+         }
+      }
+#else
+      fd_set readSet;
+      FD_ZERO(&readSet);
+      SocketInternalType highest = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         if (sockets[i] && sockets[i]->IsOpen())
+         {
+            const SocketInternalType socket = SocketInternalType(GetDescriptor(*sockets[i]));
+            FD_SET(socket, &readSet);
+            highest = socket > highest ? socket : highest;
+         }
+      }
+
+      timeval expiry;
+      timeval* expiryPointer = NULL;
+      if (timeout >= 0.0f)
+      {
+         const long microseconds = long(double(timeout) * 1000000.0);
+         expiry.tv_sec  = microseconds / 1000000L;
+         expiry.tv_usec = microseconds % 1000000L;
+         expiryPointer = &expiry;
+      }
+
+      readable = select(int(highest) + 1, &readSet, NULL, NULL, expiryPointer) > 0;
+#endif
+
+      return readable;
+   }
+
+   void Poller::Watch(const Socket* const sockets[], int count)
+   {
+#if NET_POLLER_EPOLL
+      // drop registrations for sockets that have gone away or been reopened;
+      // a closed descriptor already left the epoll set by itself, so errors are fine
+      for (size_t i = 0; i < mRegistrations.size(); )
+      {
+         bool current = false;
+         for (int j = 0; j < count && !current; ++j)
+         {
+            current = sockets[j] && sockets[j]->IsOpen() &&
+               GetDescriptor(*sockets[j]) == mRegistrations[i].mDescriptor &&
+               sockets[j]->mSerial == mRegistrations[i].mSerial;
+         }
+
+         if (current)
+         {
+            ++i;
+         }
+         else
+         {
+            epoll_ctl(mEpoll, EPOLL_CTL_DEL, mRegistrations[i].mDescriptor, NULL);
+            mRegistrations.erase(mRegistrations.begin() + i);
+         }
+      }
+
+      // add any sockets we don't know about yet
+      for (int j = 0; j < count; ++j)
+      {
+         if (!sockets[j] || !sockets[j]->IsOpen())
+         {
+            continue;
+         }
+
+         const int descriptor = GetDescriptor(*sockets[j]);
+         bool registered = false;
+         for (size_t i = 0; i < mRegistrations.size() && !registered; ++i)
+         {
+            registered = descriptor == mRegistrations[i].mDescriptor;
+         }
+
+         if (!registered)
+         {
+            epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN;
+            event.data.fd = descriptor;
+            if (epoll_ctl(mEpoll, EPOLL_CTL_ADD, descriptor, &event) == 0 || errno == EEXIST)
+            {
+               Registration registration;
+               registration.mDescriptor = descriptor;
+               registration.mSerial     = sockets[j]->mSerial;
+               mRegistrations.push_back(registration);
+            }
+         }
+      }
+#else
+      (void)sockets;
+      (void)count;
+#endif
+   }
+
+   Socket::SocketExternalType Poller::GetDescriptor(const Socket& socket)
+   {
+#if NET_PLATFORM == NET_PLATFORM_UNIX
+      // a socket using io_uring has its datagrams taken off by the ring, so
+      // the ring is what signals there is something to read
+      if (socket.mQueue && socket.mQueue->IsRunning())
+      {
+         return socket.mQueue->GetDescriptor();
+      }
+#endif
+      return socket.mSocket;
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
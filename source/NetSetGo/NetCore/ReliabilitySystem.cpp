@@ -3,12 +3,29 @@
 #include <cassert>
 #include <cstdio>
 
+#include <NetSetGo/NetCore/Bits.h>
+
 namespace net {
 
+   // how many packets, in sequence, each queue can hold at most; the acked
+   // ones are kept for twice the maximum round trip, the rest for one, so this
+   // covers sending up to 4096 packets a second. The queues only grow as far
+   // as the rate packets are really sent at needs
+   static const int kSentCapacity = 8192;
+
+   // how many sequences on from s1 s2 is, wrapping at max_sequence
+   static unsigned int sequence_distance(unsigned int s1, unsigned int s2, unsigned int max_sequence)
+   {
+      return s2 >= s1 ? s2 - s1 : max_sequence - s1 + s2 + 1;
+   }
+
 ////////////////////////////////////////////////////////////////////////////////
 
    ReliabilitySystem::ReliabilitySystem(unsigned int max_sequence)
       : mMaxSequence(max_sequence)
+      , mSentQueue(kSentCapacity, max_sequence)
+      , mPendingAckQueue(kSentCapacity, max_sequence)
+      , mAckedQueue(kSentCapacity, max_sequence)
    {
       Reset();
    }
@@ -17,40 +34,63 @@ namespace net {
    {
       mLocalSequence        = 0;
       mRemoteSequence       = 0;
+      mReceivedAny          = false;
+      mReceivedBits         = 0;
       mSentPackets          = 0;
       mRecvPackets          = 0;
       mLostPackets          = 0;
       acked_packets         = 0;
+      mDroppedPackets       = 0;
       mSentBandwidth        = 0.0f;
       mAckedBandwidth       = 0.0f;
+      mReceivedBandwidth    = 0.0f;
+      mSentPacketsPerSecond = 0.0f;
+      mReceivedPacketsPerSecond = 0.0f;
+      mLossRate             = 0.0f;
       mRoundTripTime        = 0.0f;
       mRoundTripTimeMaximum = 1.0f;
+      mClock                = 0.0;
 
-      mSentQueue.clear();
-      mReceivedQueue.clear();
-      mPendingAckQueue.clear();
-      mAckedQueue.clear();
+      mSentQueue.release();
+      mPendingAckQueue.release();
+      mAckedQueue.release();
+      mEvictedAcked.clear();
+      mEvictedPending.clear();
+
+      mSentBytes = 0;
+      mAckedBytes.Reset();
+      mAckedCount.Reset();
+      mLostCount.Reset();
+      mReceivedBytes.Reset();
+      mReceivedCount.Reset();
 
       mRecentlyAckedPackets.clear();
       mRecentlyLostPackets.clear();
    }
 
-   void ReliabilitySystem::PacketSent(int size)
+   void ReliabilitySystem::PacketSent(int size, double time)
    {
       if (mSentQueue.exists(mLocalSequence))
       {
          printf("local sequence %d exists\n", mLocalSequence);
-         for (PacketQueue::iterator itor = mSentQueue.begin(); itor != mSentQueue.end(); ++itor)
+         for (SequenceBuffer::iterator itor = mSentQueue.begin(); itor != mSentQueue.end(); ++itor)
             printf(" + %d\n", itor->mSequence);
       }
       assert(!mSentQueue.exists(mLocalSequence));
       assert(!mPendingAckQueue.exists(mLocalSequence));
       PacketData data;
       data.mSequence = mLocalSequence;
-      data.mTime = 0.0f;
+      data.mTime = mClock;
       data.mSize = size;
-      mSentQueue.push_back(data);
-      mPendingAckQueue.push_back(data);
+      data.mStamp = time;
+      PacketQueue evicted; // rarely anything, only when sending faster than the queue holds
+      mSentQueue.insert(data, &evicted);
+      mSentBytes += size;
+      for (PacketQueue::iterator itor = evicted.begin(); itor != evicted.end(); ++itor)
+      {
+         mSentBytes -= itor->mSize;
+      }
+      mPendingAckQueue.insert(data, &mEvictedPending);
       ++mSentPackets;
       ++mLocalSequence;
       if (mLocalSequence > mMaxSequence)
@@ -62,35 +102,81 @@ namespace net {
    void ReliabilitySystem::PacketReceived(unsigned int sequence, int size)
    {
       ++mRecvPackets;
-      if (mReceivedQueue.exists(sequence))
+      mReceivedBytes.Add(size);
+      mReceivedCount.Add();
+      if (!mReceivedAny)
       {
-         return;
+         mReceivedAny = true;
+         mRemoteSequence = sequence;
+         mReceivedBits = 0;
       }
-      PacketData data;
-      data.mSequence = sequence;
-      data.mTime = 0.0f;
-      data.mSize = size;
-      mReceivedQueue.push_back(data);
-      if (sequence_more_recent(sequence, mRemoteSequence, mMaxSequence))
+      else if (sequence_more_recent(sequence, mRemoteSequence, mMaxSequence))
       {
+         // the history moves along, the old remote sequence becoming one of it
+         const unsigned int shift = sequence_distance(mRemoteSequence, sequence, mMaxSequence);
+         mReceivedBits = shift < 32 ? (mReceivedBits << shift) | (1u << (shift - 1)) : (shift == 32 ? 1u << 31 : 0);
          mRemoteSequence = sequence;
       }
+      else if (sequence != mRemoteSequence)
+      {
+         // one too old for the history is too old to ack
+         const unsigned int bit_index = sequence_distance(sequence, mRemoteSequence, mMaxSequence) - 1;
+         if (bit_index <= 31)
+         {
+            mReceivedBits |= 1u << bit_index;
+         }
+      }
+   }
+
+   void ReliabilitySystem::StampSent(unsigned int sequence, double time)
+   {
+      PacketData* data = mPendingAckQueue.find(sequence);
+      if (data)
+      {
+         data->mStamp = time;
+      }
+   }
+
+   void ReliabilitySystem::PacketDropped()
+   {
+      ++mDroppedPackets;
    }
 
    unsigned int ReliabilitySystem::GenerateAckBits()
    {
-      return generate_ack_bits(GetRemoteSequence(), mReceivedQueue, mMaxSequence);
+      return mReceivedBits;
    }
 
-   void ReliabilitySystem::ProcessAck(unsigned int ack, unsigned int ack_bits)
+   void ReliabilitySystem::ProcessAck(unsigned int ack, unsigned int ack_bits, double time)
    {
-      process_ack(ack, ack_bits, mPendingAckQueue, mAckedQueue, mAcks, acked_packets, mRoundTripTime, mMaxSequence);
+      const size_t numAcks = mAcks.size();
+      PacketQueue evicted;
+      process_ack(ack, ack_bits, mPendingAckQueue, mAckedQueue, mAcks, acked_packets, mRoundTripTime, mMaxSequence, mClock, time, &evicted);
+
+      for (size_t i = numAcks; i < mAcks.size(); ++i)
+      {
+         // one that didn't fit in the acked queue is among those pushed out
+         const PacketData* data = mAckedQueue.find(mAcks[i]);
+         for (PacketQueue::iterator itor = evicted.begin(); !data && itor != evicted.end(); ++itor)
+         {
+            data = itor->mSequence == mAcks[i] ? &*itor : NULL;
+         }
+         assert(data);
+         mAckedBytes.Add(data->mSize);
+         mAckedCount.Add();
+      }
+      mEvictedAcked.splice(mEvictedAcked.end(), evicted);
    }
 
    void ReliabilitySystem::Update(float deltaTime)
    {
       mAcks.clear();
-      AdvanceQueueTime(deltaTime);
+      mClock += deltaTime;
+      mAckedBytes.Advance(deltaTime);
+      mAckedCount.Advance(deltaTime);
+      mLostCount.Advance(deltaTime);
+      mReceivedBytes.Advance(deltaTime);
+      mReceivedCount.Advance(deltaTime);
       UpdateQueues();
       UpdateStats();
       #ifdef NET_UNIT_TEST
@@ -101,10 +187,9 @@ namespace net {
    bool ReliabilitySystem::Validate() const
    {
       bool validated = true; // true until proven otherwise
-      validated = validated && mSentQueue.verify_sorted(mMaxSequence);
-      validated = validated && mReceivedQueue.verify_sorted(mMaxSequence);
-      validated = validated && mPendingAckQueue.verify_sorted(mMaxSequence);
-      validated = validated && mAckedQueue.verify_sorted(mMaxSequence);
+      validated = validated && mSentQueue.verify_sorted();
+      validated = validated && mPendingAckQueue.verify_sorted();
+      validated = validated && mAckedQueue.verify_sorted();
       return validated;
    }
 
@@ -112,8 +197,7 @@ namespace net {
 
    bool ReliabilitySystem::sequence_more_recent(unsigned int s1, unsigned int s2, unsigned int max_sequence)
    {
-      return (s1 > s2) && (s1 - s2 <= max_sequence/2)
-         ||  (s2 > s1) && (s2 - s1 > max_sequence/2);
+      return net::sequence_more_recent(s1, s2, max_sequence);
    }
 
    int ReliabilitySystem::bit_index_for_sequence(unsigned int sequence, unsigned int ack, unsigned int max_sequence)
@@ -134,159 +218,103 @@ namespace net {
       }
    }
 
-   unsigned int ReliabilitySystem::generate_ack_bits(unsigned int ack, const PacketQueue& received_queue, unsigned int max_sequence)
-   {
-      unsigned int ack_bits = 0;
-      for (PacketQueue::const_iterator itor = received_queue.begin(); itor != received_queue.end(); itor++)
-      {
-         if (itor->mSequence == ack || sequence_more_recent(itor->mSequence, ack, max_sequence))
-         {
-            break;
-         }
-         int bit_index = bit_index_for_sequence(itor->mSequence, ack, max_sequence);
-         if (bit_index <= 31)
-         {
-            ack_bits |= 1 << bit_index;
-         }
-      }
-      return ack_bits;
-   }
-
    void ReliabilitySystem::process_ack(unsigned int ack, unsigned int ack_bits,
-                      PacketQueue& pending_ack_queue, PacketQueue& acked_queue,
+                      SequenceBuffer& pending_ack_queue, SequenceBuffer& acked_queue,
                       std::vector<unsigned int>& acks, unsigned int& acked_packets,
-                      float& rtt, unsigned int max_sequence)
+                      float& rtt, unsigned int max_sequence, double clock, double time,
+                      PacketQueue* evicted_acked)
    {
       if (pending_ack_queue.empty())
       {
          return;
       }
 
-      PacketQueue::iterator itor = pending_ack_queue.begin();
-      while (itor != pending_ack_queue.end())
+      // the ack, then the packets set in the bits, are looked up rather than
+      // the queue walked; the work is in how many were acked
+      unsigned int sequence = ack;
+      unsigned int bits = ack_bits;
+      while (true)
       {
-         bool acked = false;
-
-         if (itor->mSequence == ack)
+         const PacketData* data = pending_ack_queue.find(sequence);
+         if (data)
          {
-            acked = true;
-         }
-         else if (!sequence_more_recent(itor->mSequence, ack, max_sequence))
-         {
-            int bit_index = bit_index_for_sequence(itor->mSequence, ack, max_sequence);
-            if (bit_index <= 31)
+            // the clock only advances once per update, so use the send and
+            // ack times where we have them (and the clock didn't jump)
+            const double age = clock - data->mTime;
+            float sample = float(age);
+            if (time > 0.0 && data->mStamp > 0.0 && time >= data->mStamp && time - data->mStamp < age + 1.0)
             {
-               acked = (ack_bits >> bit_index) & 1;
+               sample = float(time - data->mStamp);
             }
-         }
+            rtt += (sample - rtt) * 0.1f;
 
-         if (acked)
-         {
-            rtt += (itor->mTime - rtt) * 0.1f;
-
-            acked_queue.insert_sorted(*itor, max_sequence);
-            acks.push_back(itor->mSequence);
+            acked_queue.insert(*data, evicted_acked);
+            acks.push_back(sequence);
             acked_packets++;
-            itor = pending_ack_queue.erase(itor);
+            pending_ack_queue.erase(sequence);
          }
-         else
+
+         if (bits == 0)
          {
-            ++itor;
+            break;
          }
+         const unsigned int bit_index = LowestBit(bits);
+         bits &= bits - 1;
+         sequence = ack > bit_index ? ack - 1 - bit_index : max_sequence - (bit_index - ack);
       }
    }
 
-   /*
-   // data accessors
-   void ReliabilitySystem::GetAcks(unsigned int** acks, int& count)
-   {
-      *acks = &mAcks[0];
-      count = (int)mAcks.size();
-   }
-   //*/
-
 ////////////////////////////////////////////////////////////////////////////////
 
-   void ReliabilitySystem::AdvanceQueueTime(float deltaTime)
-   {
-      for (PacketQueue::iterator itor = mSentQueue.begin(); itor != mSentQueue.end(); ++itor)
-      {
-         itor->mTime += deltaTime;
-      }
-
-      for (PacketQueue::iterator itor = mReceivedQueue.begin(); itor != mReceivedQueue.end(); ++itor)
-      {
-         itor->mTime += deltaTime;
-      }
-
-      for (PacketQueue::iterator itor = mPendingAckQueue.begin(); itor != mPendingAckQueue.end(); ++itor)
-      {
-         itor->mTime += deltaTime;
-      }
-
-      for (PacketQueue::iterator itor = mAckedQueue.begin(); itor != mAckedQueue.end(); ++itor)
-      {
-         itor->mTime += deltaTime;
-      }
-   }
-
    void ReliabilitySystem::UpdateQueues()
    {
       const float epsilon = 0.001f;
 
-      while (mSentQueue.size() && mSentQueue.front().mTime > mRoundTripTimeMaximum + epsilon)
+      while (mSentQueue.size() && mClock - mSentQueue.front().mTime > mRoundTripTimeMaximum + epsilon)
       {
+         mSentBytes -= mSentQueue.front().mSize;
          mSentQueue.pop_front();
       }
 
-      if (mReceivedQueue.size())
-      {
-         const unsigned int latest_sequence = mReceivedQueue.back().mSequence;
-         const unsigned int minimum_sequence = latest_sequence >= 34 ? (latest_sequence - 34) : mMaxSequence - (34 - latest_sequence);
-         while (mReceivedQueue.size() && !sequence_more_recent(mReceivedQueue.front().mSequence, minimum_sequence, mMaxSequence))
-         {
-            mReceivedQueue.pop_front();
-         }
-      }
-
       mRecentlyAckedPackets.clear();
-      while (mAckedQueue.size() && mAckedQueue.front().mTime > mRoundTripTimeMaximum * 2 - epsilon)
+      mRecentlyAckedPackets.splice(mRecentlyAckedPackets.end(), mEvictedAcked);
+      while (mAckedQueue.size() && mClock - mAckedQueue.front().mTime > mRoundTripTimeMaximum * 2 - epsilon)
       {
          mRecentlyAckedPackets.push_back(mAckedQueue.front());
          mAckedQueue.pop_front();
       }
 
       mRecentlyLostPackets.clear();
-      while (mPendingAckQueue.size() && mPendingAckQueue.front().mTime > mRoundTripTimeMaximum + epsilon)
+      for (PacketQueue::iterator itor = mEvictedPending.begin(); itor != mEvictedPending.end(); ++itor)
+      {
+         ++mLostPackets;
+         mLostCount.Add();
+      }
+      mRecentlyLostPackets.splice(mRecentlyLostPackets.end(), mEvictedPending);
+      while (mPendingAckQueue.size() && mClock - mPendingAckQueue.front().mTime > mRoundTripTimeMaximum + epsilon)
       {
          //printf("ReliabilitySystem: uhoh, lost packet seq# %u\n", mPendingAckQueue.front().mSequence);
          mRecentlyLostPackets.push_back(mPendingAckQueue.front());
          mPendingAckQueue.pop_front();
          ++mLostPackets;
+         mLostCount.Add();
       }
    }
 
    void ReliabilitySystem::UpdateStats()
    {
-      int sent_bytes_per_second = 0;
-      for (PacketQueue::iterator itor = mSentQueue.begin(); itor != mSentQueue.end(); ++itor)
-      {
-         sent_bytes_per_second += itor->mSize;
-      }
-      int acked_packets_per_second = 0;
-      int acked_bytes_per_second = 0;
-      for (PacketQueue::iterator itor = mAckedQueue.begin(); itor != mAckedQueue.end(); ++itor)
-      {
-         if (itor->mTime >= mRoundTripTimeMaximum)
-         {
-            acked_packets_per_second++;
-            acked_bytes_per_second += itor->mSize;
-         }
-      }
-      sent_bytes_per_second = int(float(sent_bytes_per_second) / mRoundTripTimeMaximum);
-      acked_bytes_per_second = int(float(acked_bytes_per_second) / mRoundTripTimeMaximum);
-      mSentBandwidth = sent_bytes_per_second * (8 / 1000.0f);
-      mAckedBandwidth = acked_bytes_per_second * (8 / 1000.0f);
+      // nothing here is summed; the sent bytes are kept as the sent queue
+      // changes, and the rest in windows of the last second
+      const float kbps = 8 / 1000.0f;
+      mSentBandwidth = float(mSentBytes) / mRoundTripTimeMaximum * kbps;
+      mSentPacketsPerSecond = float(mSentQueue.size()) / mRoundTripTimeMaximum;
+      mAckedBandwidth = float(mAckedBytes.GetRate()) * kbps;
+      mReceivedBandwidth = float(mReceivedBytes.GetRate()) * kbps;
+      mReceivedPacketsPerSecond = float(mReceivedCount.GetRate());
+
+      const double acked = mAckedCount.GetTotal();
+      const double lost = mLostCount.GetTotal();
+      mLossRate = acked + lost > 0.0 ? float(lost / (acked + lost)) : 0.0f;
    }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,241 @@
+#include <NetSetGo/NetCore/SequenceBuffer.h>
+
+#include <cassert>
+
+namespace net {
+
+   // the fewest slots the ring grows to at first
+   static const unsigned int kMinSlots = 16;
+
+////////////////////////////////////////////////////////////////////////////////
+
+   SequenceBuffer::iterator& SequenceBuffer::iterator::operator++()
+   {
+      do
+      {
+         ++mOffset;
+      }
+      while (mOffset < mBuffer->mSpan && !mBuffer->mValid[mBuffer->GetSlot(mOffset)]);
+      return *this;
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   SequenceBuffer::SequenceBuffer(int capacity, unsigned int max_sequence)
+      : mMaxSequence(max_sequence)
+      , mCapacity(1)
+      , mMask(0)
+      , mFirstSlot(0)
+      , mSpan(0)
+      , mSize(0)
+   {
+      assert(capacity > 0);
+      while (mCapacity < (unsigned int)capacity)
+      {
+         mCapacity <<= 1;
+      }
+   }
+
+   void SequenceBuffer::clear()
+   {
+      mValid.assign(mValid.size(), 0);
+      mFirstSlot = 0;
+      mSpan = 0;
+      mSize = 0;
+   }
+
+   void SequenceBuffer::release()
+   {
+      std::vector<PacketData>().swap(mEntries);
+      std::vector<unsigned char>().swap(mValid);
+      mMask = 0;
+      clear();
+   }
+
+   PacketData* SequenceBuffer::find(unsigned int sequence)
+   {
+      const unsigned int offset = GetOffset(sequence);
+      if (offset < mSpan)
+      {
+         const int slot = GetSlot(offset);
+         if (mValid[slot])
+         {
+            return &mEntries[slot];
+         }
+      }
+      return NULL;
+   }
+
+   const PacketData* SequenceBuffer::find(unsigned int sequence) const
+   {
+      return const_cast<SequenceBuffer*>(this)->find(sequence);
+   }
+
+   void SequenceBuffer::insert(const PacketData& p, PacketQueue* evicted)
+   {
+      assert(p.mSequence <= mMaxSequence);
+      assert(!exists(p.mSequence));
+
+      // grow to hold the packets as far apart as this one makes them
+      unsigned int span = 1;
+      if (!empty())
+      {
+         span = sequence_more_recent(p.mSequence, front().mSequence, mMaxSequence)
+            ? GetOffset(p.mSequence) + 1
+            : GetDistance(p.mSequence, front().mSequence) + mSpan;
+      }
+      if (span > mEntries.size() && mEntries.size() < mCapacity)
+      {
+         Grow(span);
+      }
+      const unsigned int capacity = mMask + 1;
+
+      // newer than the oldest, push out the oldest until it fits
+      if (!empty() && sequence_more_recent(p.mSequence, front().mSequence, mMaxSequence))
+      {
+         while (!empty() && GetOffset(p.mSequence) >= capacity)
+         {
+            if (evicted)
+            {
+               evicted->push_back(front());
+            }
+            pop_front();
+         }
+      }
+
+      int slot = 0;
+      if (empty())
+      {
+         mFirstSlot = 0;
+         mSpan = 1;
+      }
+      else if (sequence_more_recent(p.mSequence, front().mSequence, mMaxSequence))
+      {
+         const unsigned int offset = GetOffset(p.mSequence);
+         slot = GetSlot(offset);
+         mSpan = offset >= mSpan ? offset + 1 : mSpan;
+      }
+      else
+      {
+         // older than the oldest, the ring reaches back for it if it can
+         const unsigned int back = GetDistance(p.mSequence, front().mSequence);
+         if (back + mSpan > capacity)
+         {
+            if (evicted)
+            {
+               evicted->push_back(p);
+            }
+            return;
+         }
+         mFirstSlot = (mFirstSlot - back) & mMask;
+         mSpan += back;
+         slot = int(mFirstSlot);
+      }
+
+      mEntries[slot] = p;
+      mValid[slot] = 1;
+      ++mSize;
+   }
+
+   bool SequenceBuffer::erase(unsigned int sequence)
+   {
+      const unsigned int offset = GetOffset(sequence);
+      if (offset >= mSpan || !mValid[GetSlot(offset)])
+      {
+         return false;
+      }
+      mValid[GetSlot(offset)] = 0;
+      --mSize;
+      Trim();
+      return true;
+   }
+
+   SequenceBuffer::iterator SequenceBuffer::erase(iterator itor)
+   {
+      assert(itor.mBuffer == this && itor.mOffset < mSpan);
+      iterator next = itor;
+      ++next;
+      const bool last = next == end();
+      const unsigned int nextSequence = last ? 0 : next->mSequence;
+
+      erase(itor->mSequence);
+
+      // the oldest may have moved on, and the offsets with it
+      return last ? end() : iterator(this, GetOffset(nextSequence));
+   }
+
+   void SequenceBuffer::pop_front()
+   {
+      assert(!empty());
+      mValid[mFirstSlot] = 0;
+      --mSize;
+      Trim();
+   }
+
+   bool SequenceBuffer::verify_sorted() const
+   {
+      bool verified = mSize == 0 ? mSpan == 0 : (mValid[mFirstSlot] && mValid[GetSlot(mSpan - 1)]);
+      int count = 0;
+      for (unsigned int offset = 0; verified && offset < mSpan; ++offset)
+      {
+         const int slot = GetSlot(offset);
+         if (mValid[slot])
+         {
+            verified = mEntries[slot].mSequence <= mMaxSequence && GetOffset(mEntries[slot].mSequence) == offset;
+            ++count;
+         }
+      }
+      return verified && count == mSize;
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   unsigned int SequenceBuffer::GetDistance(unsigned int from, unsigned int to) const
+   {
+      return to >= from ? to - from : mMaxSequence - from + to + 1;
+   }
+
+   void SequenceBuffer::Grow(unsigned int span)
+   {
+      unsigned int slots = mEntries.empty() ? (kMinSlots < mCapacity ? kMinSlots : mCapacity) : unsigned(mEntries.size());
+      while (slots < span && slots < mCapacity)
+      {
+         slots <<= 1;
+      }
+
+      // the packets held move to the start of the new ring, in order
+      std::vector<PacketData> entries(slots);
+      std::vector<unsigned char> valid(slots, 0);
+      for (unsigned int offset = 0; offset < mSpan; ++offset)
+      {
+         entries[offset] = mEntries[GetSlot(offset)];
+         valid[offset] = mValid[GetSlot(offset)];
+      }
+      mEntries.swap(entries);
+      mValid.swap(valid);
+      mMask = slots - 1;
+      mFirstSlot = 0;
+   }
+
+   void SequenceBuffer::Trim()
+   {
+      if (mSize == 0)
+      {
+         mFirstSlot = 0;
+         mSpan = 0;
+         return;
+      }
+      while (!mValid[mFirstSlot])
+      {
+         mFirstSlot = (mFirstSlot + 1) & mMask;
+         --mSpan;
+      }
+      while (!mValid[GetSlot(mSpan - 1)])
+      {
+         --mSpan;
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
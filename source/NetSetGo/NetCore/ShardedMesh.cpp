@@ -0,0 +1,77 @@
+#include <NetSetGo/NetCore/ShardedMesh.h>
+
+#include <cassert>
+#include <cstdio>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   ShardedMesh::ShardedMesh(unsigned int protocolId, int numShards, int maxNodes, float sendRate, float timeout)
+      : mTable(maxNodes)
+   {
+      assert(numShards >= 1);
+      assert(maxNodes >= numShards);
+
+      // split the node IDs as evenly as we can, the first shards taking one
+      // each of what's left over
+      const int nodesPerShard = maxNodes / numShards;
+      const int remainder = maxNodes % numShards;
+      int firstNodeID = 0;
+      for (int shard = 0; shard < numShards; ++shard)
+      {
+         const int numNodes = shard < remainder ? nodesPerShard + 1 : nodesPerShard;
+         mShards.push_back(new Mesh(protocolId, mTable, NodeID(firstNodeID), numNodes, sendRate, timeout));
+         firstNodeID += numNodes;
+      }
+      assert(firstNodeID == maxNodes);
+   }
+
+   ShardedMesh::~ShardedMesh()
+   {
+      Stop();
+      for (size_t i = 0; i < mShards.size(); ++i)
+      {
+         delete mShards[i];
+      }
+      mShards.clear();
+   }
+
+   bool ShardedMesh::Start(int port)
+   {
+      for (size_t i = 0; i < mShards.size(); ++i)
+      {
+         if (!mShards[i]->Start(port))
+         {
+            printf("failed to start mesh shard %d of %d\n", int(i), int(mShards.size()));
+            Stop();
+            return false;
+         }
+      }
+      return true;
+   }
+
+   void ShardedMesh::Stop()
+   {
+      for (size_t i = 0; i < mShards.size(); ++i)
+      {
+         mShards[i]->Stop();
+      }
+   }
+
+   bool ShardedMesh::IsRunning() const
+   {
+      return !mShards.empty() && mShards[0]->IsRunning();
+   }
+
+   void ShardedMesh::Update(float deltaTime)
+   {
+      for (size_t i = 0; i < mShards.size(); ++i)
+      {
+         mShards[i]->Update(deltaTime);
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -0,0 +1,473 @@
+#include <NetSetGo/NetCore/SharedMemoryTransport.h>
+#include <NetSetGo/NetCore/Socket.h>
+
+#if NET_PLATFORM != NET_PLATFORM_WINDOWS
+#   define NET_SHARED_MEMORY 1 // shm_open() and mmap() are available
+#   include <sys/mman.h>
+#   include <sys/stat.h>
+#   include <fcntl.h>
+#   include <signal.h>
+#   include <unistd.h>
+#   include <errno.h>
+#else
+#   define NET_SHARED_MEMORY 0
+#endif
+
+#include <cassert>
+#include <cstring>
+#include <stdio.h>
+
+namespace net {
+
+   // "NSGR", so a sender can tell an inbox is ready for use
+   static const unsigned int kRingMagic = 0x4E534752;
+
+   static const unsigned int kLoopback = (127u << 24) | 1u;
+
+   static const size_t kCacheLineSize = 64;
+
+   /**
+    * The start of every inbox. Senders claim slots by bumping mTail, which
+    * has a cache line to itself since it is what they all contend for.
+    */
+   struct RingHeader
+   {
+      unsigned int mMagic; // written last, once the slots are ready
+      unsigned int mSlotSize; // payload bytes per slot
+      unsigned int mNumSlots;
+      unsigned int mSlotStride; // bytes from one slot to the next
+      unsigned int mClosed; // set when the owner lets go, so senders do too
+      unsigned int mDrops; // datagrams senders found no room for
+      int mOwner; // process id, to tell a live inbox from one left behind
+      char mPadding[kCacheLineSize - 7 * sizeof(unsigned int)];
+      unsigned long long mTail; // the next slot to be claimed
+      char mTailPadding[kCacheLineSize - sizeof(unsigned long long)];
+   };
+
+   /**
+    * The start of every slot, the payload following right behind it. A slot
+    * is free to claim at position p when mSequence is p, and holds a datagram
+    * ready to read once mSequence is p + 1; reading it and giving it back
+    * moves mSequence on to p + the number of slots, for the next time around.
+    */
+   struct SlotHeader
+   {
+      unsigned long long mSequence;
+      double mTime; // when it was sent, on the Socket::GetTime() clock
+      unsigned short mSender; // port
+      unsigned short mUnused;
+      int mSize;
+   };
+
+   static unsigned long long LoadSequence(const unsigned long long* sequence)
+   {
+#if NET_SHARED_MEMORY
+      return __atomic_load_n(sequence, __ATOMIC_ACQUIRE);
+#else
+      return *sequence;
+#endif
+   }
+
+   static void StoreSequence(unsigned long long* sequence, unsigned long long value)
+   {
+#if NET_SHARED_MEMORY
+      __atomic_store_n(sequence, value, __ATOMIC_RELEASE);
+#else
+      *sequence = value;
+#endif
+   }
+
+   static SlotHeader* GetSlot(void* ring, unsigned long long position)
+   {
+      RingHeader* header = reinterpret_cast<RingHeader*>(ring);
+      unsigned char* slots = reinterpret_cast<unsigned char*>(ring) + sizeof(RingHeader);
+      const size_t index = size_t(position & (header->mNumSlots - 1));
+      return reinterpret_cast<SlotHeader*>(slots + index * header->mSlotStride);
+   }
+
+   // claims the next slot of a ring to write a datagram into, unless its owner
+   // has yet to read the one a lap behind it, in which case the ring is full
+   static SlotHeader* ClaimSlot(void* ring, unsigned long long& position)
+   {
+#if NET_SHARED_MEMORY
+      RingHeader* header = reinterpret_cast<RingHeader*>(ring);
+      position = __atomic_load_n(&header->mTail, __ATOMIC_RELAXED);
+      for (;;)
+      {
+         SlotHeader* slot = GetSlot(ring, position);
+         const long long lag = (long long)(LoadSequence(&slot->mSequence) - position);
+         if (lag == 0)
+         {
+            if (__atomic_compare_exchange_n(&header->mTail, &position, position + 1, true, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED))
+            {
+               return slot;
+            }
+         }
+         else if (lag < 0)
+         {
+            __atomic_fetch_add(&header->mDrops, 1u, __ATOMIC_RELAXED);
+            return NULL;
+         }
+         else
+         {
+            position = __atomic_load_n(&header->mTail, __ATOMIC_RELAXED); // another sender got there first
+         }
+      }
+#else
+      (void)ring;
+      (void)position;
+      return NULL;
+#endif
+   }
+
+#if NET_SHARED_MEMORY
+   static void GetName(unsigned short port, char name[32])
+   {
+      snprintf(name, 32, "/netsetgo-%u", (unsigned int)port);
+   }
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+
+   SharedMemoryTransport::SharedMemoryTransport(int slotSize, int numSlots)
+      : mSlotSize(slotSize)
+      , mNumSlots(numSlots)
+      , mPort(0)
+      , mInbox(NULL)
+      , mInboxSize(0)
+      , mHead(0)
+      , mReleased(0)
+      , mSendDrops(0)
+   {
+      assert(mSlotSize > 0);
+      assert(mNumSlots > 0 && (mNumSlots & (mNumSlots - 1)) == 0);
+   }
+
+   SharedMemoryTransport::~SharedMemoryTransport()
+   {
+      Close();
+   }
+
+   bool SharedMemoryTransport::Open(unsigned short port)
+   {
+      assert(!IsOpen());
+
+#if NET_SHARED_MEMORY
+      char name[32];
+      GetName(port, name);
+
+      // an inbox whose owner died without closing it is taken over, its
+      // senders being told to let go of it; one still in use is not
+      int existing = shm_open(name, O_RDWR, 0);
+      if (existing >= 0)
+      {
+         void* memory = mmap(NULL, sizeof(RingHeader), PROT_READ | PROT_WRITE, MAP_SHARED, existing, 0);
+         close(existing);
+         if (memory != MAP_FAILED)
+         {
+            RingHeader* header = reinterpret_cast<RingHeader*>(memory);
+            const bool closed = __atomic_load_n(&header->mClosed, __ATOMIC_ACQUIRE) != 0;
+            const bool alive = header->mOwner > 0 && (kill(header->mOwner, 0) == 0 || errno == EPERM);
+            if (!closed && alive)
+            {
+               munmap(memory, sizeof(RingHeader));
+               printf("shared memory port %u is already in use\n", (unsigned int)port);
+               return false;
+            }
+            __atomic_store_n(&header->mClosed, 1u, __ATOMIC_RELEASE);
+            munmap(memory, sizeof(RingHeader));
+         }
+         shm_unlink(name);
+      }
+
+      const size_t stride = (sizeof(SlotHeader) + size_t(mSlotSize) + kCacheLineSize - 1) / kCacheLineSize * kCacheLineSize;
+      const size_t size = sizeof(RingHeader) + stride * size_t(mNumSlots);
+
+      const int descriptor = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0600);
+      if (descriptor < 0)
+      {
+         printf("failed to create shared memory inbox\n");
+         return false;
+      }
+      if (ftruncate(descriptor, off_t(size)) < 0)
+      {
+         printf("failed to size shared memory inbox\n");
+         close(descriptor);
+         shm_unlink(name);
+         return false;
+      }
+      void* memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+      close(descriptor);
+      if (memory == MAP_FAILED)
+      {
+         printf("failed to map shared memory inbox\n");
+         shm_unlink(name);
+         return false;
+      }
+
+      // fresh shared memory is zeroed, so only what isn't zero is filled in
+      RingHeader* header = reinterpret_cast<RingHeader*>(memory);
+      header->mSlotSize   = (unsigned int)mSlotSize;
+      header->mNumSlots   = (unsigned int)mNumSlots;
+      header->mSlotStride = (unsigned int)stride;
+      header->mOwner      = int(getpid());
+      for (int i = 0; i < mNumSlots; ++i)
+      {
+         GetSlot(memory, i)->mSequence = (unsigned long long)i;
+      }
+      __atomic_store_n(&header->mMagic, kRingMagic, __ATOMIC_RELEASE);
+
+      mInbox = memory;
+      mInboxSize = size;
+      mPort = port;
+      mHead = 0;
+      mReleased = 0;
+      mSendDrops = 0;
+      return true;
+#else
+      (void)port;
+      printf("shared memory transports are not supported on this platform\n");
+      return false;
+#endif
+   }
+
+   void SharedMemoryTransport::Close()
+   {
+#if NET_SHARED_MEMORY
+      while (!mOutboxes.empty())
+      {
+         DropOutbox(mOutboxes.begin()->first);
+      }
+
+      if (IsOpen())
+      {
+         RingHeader* header = reinterpret_cast<RingHeader*>(mInbox);
+         __atomic_store_n(&header->mClosed, 1u, __ATOMIC_RELEASE);
+         munmap(mInbox, mInboxSize);
+
+         char name[32];
+         GetName(mPort, name);
+         shm_unlink(name);
+      }
+#endif
+      mInbox = NULL;
+      mInboxSize = 0;
+   }
+
+   bool SharedMemoryTransport::Send(const net::Address& destination, const void* data, int size)
+   {
+      Buffer buffer;
+      buffer.mData = data;
+      buffer.mSize = size;
+      return SendV(destination, &buffer, 1);
+   }
+
+   bool SharedMemoryTransport::SendV(const net::Address& destination, const Buffer buffers[], int count)
+   {
+      assert(buffers);
+      assert(count > 0);
+
+      if (!IsOpen() || destination.GetAddress() != kLoopback)
+      {
+         return false;
+      }
+
+      void* outbox = GetOutbox(destination.GetPort());
+      if (!outbox)
+      {
+         return false; // nobody there, as good as sent
+      }
+      RingHeader* header = reinterpret_cast<RingHeader*>(outbox);
+
+      int size = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         size += buffers[i].mSize;
+      }
+      if (size > int(header->mSlotSize))
+      {
+         return false;
+      }
+
+      unsigned long long position = 0;
+      SlotHeader* slot = ClaimSlot(outbox, position);
+      if (!slot)
+      {
+         ++mSendDrops;
+         return false;
+      }
+
+      unsigned char* payload = reinterpret_cast<unsigned char*>(slot) + sizeof(SlotHeader);
+      int offset = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         memcpy(&payload[offset], buffers[i].mData, buffers[i].mSize);
+         offset += buffers[i].mSize;
+      }
+      slot->mTime = Socket::GetTime();
+      slot->mSender = mPort;
+      slot->mSize = size;
+      StoreSequence(&slot->mSequence, position + 1);
+
+      return true;
+   }
+
+   int SharedMemoryTransport::Receive(net::Address& sender, void* data, int size)
+   {
+      assert(data);
+      assert(size > 0);
+
+      int received_bytes = 0;
+      Datagram datagram;
+      if (ReceiveInPlace(&datagram, 1) == 1)
+      {
+         received_bytes = datagram.mSize < size ? datagram.mSize : size;
+         memcpy(data, datagram.mData, received_bytes);
+         sender = datagram.mAddress;
+      }
+      ReleaseReceived();
+      return received_bytes;
+   }
+
+   int SharedMemoryTransport::ReceiveBatch(Datagram datagrams[], int count)
+   {
+      assert(datagrams || count == 0);
+
+      int received = 0;
+      Datagram inPlace;
+      while (received < count && ReceiveInPlace(&inPlace, 1) == 1)
+      {
+         Datagram& datagram = datagrams[received++];
+         assert(datagram.mData);
+         datagram.mAddress = inPlace.mAddress;
+         datagram.mSize = inPlace.mSize <= datagram.mSize ? inPlace.mSize : 0;
+         datagram.mSegmentSize = datagram.mSize;
+         datagram.mTime = inPlace.mTime;
+         memcpy(datagram.mData, inPlace.mData, datagram.mSize);
+         ReleaseReceived();
+      }
+      return received;
+   }
+
+   int SharedMemoryTransport::ReceiveInPlace(Datagram datagrams[], int count)
+   {
+      assert(datagrams || count == 0);
+      assert(mReleased == mHead); // the last ones handed out must be released first
+
+      int received = 0;
+      while (IsOpen() && received < count)
+      {
+         SlotHeader* slot = GetSlot(mInbox, mHead);
+         if (LoadSequence(&slot->mSequence) != mHead + 1)
+         {
+            break; // nothing more has been sent
+         }
+
+         // the size is the sender's word, so one that would run past the slot
+         // is taken for a corrupt datagram, handed out empty
+         const int size = slot->mSize;
+         Datagram& datagram = datagrams[received++];
+         datagram.mAddress = Address(kLoopback, slot->mSender);
+         datagram.mData = reinterpret_cast<unsigned char*>(slot) + sizeof(SlotHeader);
+         datagram.mSize = size >= 0 && size <= mSlotSize ? size : 0;
+         datagram.mSegmentSize = datagram.mSize;
+         datagram.mTime = slot->mTime;
+         ++mHead;
+      }
+      return received;
+   }
+
+   void SharedMemoryTransport::ReleaseReceived()
+   {
+      // hand the slots back to the senders for their next lap
+      for (; IsOpen() && mReleased < mHead; ++mReleased)
+      {
+         StoreSequence(&GetSlot(mInbox, mReleased)->mSequence, mReleased + (unsigned long long)mNumSlots);
+      }
+   }
+
+   unsigned int SharedMemoryTransport::GetReceiveDrops() const
+   {
+      if (!IsOpen())
+      {
+         return 0;
+      }
+#if NET_SHARED_MEMORY
+      return __atomic_load_n(&reinterpret_cast<RingHeader*>(mInbox)->mDrops, __ATOMIC_RELAXED);
+#else
+      return 0;
+#endif
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   void* SharedMemoryTransport::GetOutbox(unsigned short port)
+   {
+#if NET_SHARED_MEMORY
+      // an inbox whose owner has since closed it is looked up afresh
+      std::map<unsigned short, Region>::iterator itor = mOutboxes.find(port);
+      if (itor != mOutboxes.end())
+      {
+         RingHeader* header = reinterpret_cast<RingHeader*>(itor->second.mMemory);
+         if (!__atomic_load_n(&header->mClosed, __ATOMIC_ACQUIRE))
+         {
+            return itor->second.mMemory;
+         }
+         DropOutbox(port);
+      }
+
+      char name[32];
+      GetName(port, name);
+      const int descriptor = shm_open(name, O_RDWR, 0);
+      if (descriptor < 0)
+      {
+         return NULL;
+      }
+
+      struct stat status;
+      void* memory = MAP_FAILED;
+      if (fstat(descriptor, &status) == 0 && size_t(status.st_size) >= sizeof(RingHeader))
+      {
+         memory = mmap(NULL, size_t(status.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+      }
+      close(descriptor);
+      if (memory == MAP_FAILED)
+      {
+         return NULL;
+      }
+
+      // the owner may still be setting it up
+      RingHeader* header = reinterpret_cast<RingHeader*>(memory);
+      if (__atomic_load_n(&header->mMagic, __ATOMIC_ACQUIRE) != kRingMagic ||
+         sizeof(RingHeader) + size_t(header->mSlotStride) * header->mNumSlots > size_t(status.st_size))
+      {
+         munmap(memory, size_t(status.st_size));
+         return NULL;
+      }
+
+      Region region;
+      region.mMemory = memory;
+      region.mSize = size_t(status.st_size);
+      mOutboxes[port] = region;
+      return memory;
+#else
+      (void)port;
+      return NULL;
+#endif
+   }
+
+   void SharedMemoryTransport::DropOutbox(unsigned short port)
+   {
+      std::map<unsigned short, Region>::iterator itor = mOutboxes.find(port);
+      if (itor != mOutboxes.end())
+      {
+#if NET_SHARED_MEMORY
+         munmap(itor->second.mMemory, itor->second.mSize);
+#endif
+         mOutboxes.erase(itor);
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -0,0 +1,60 @@
+#include <NetSetGo/NetCore/SlidingWindow.h>
+
+#include <cassert>
+#include <cmath>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   SlidingWindow::SlidingWindow(float duration, int numBuckets)
+      : mBucketDuration(duration / float(numBuckets))
+      , mBucketTime(0.0f)
+      , mCurrent(0)
+      , mTotal(0.0)
+      , mBuckets(numBuckets, 0.0)
+   {
+      assert(duration > 0.0f);
+      assert(numBuckets > 0);
+   }
+
+   void SlidingWindow::Add(double value)
+   {
+      mBuckets[mCurrent] += value;
+      mTotal += value;
+   }
+
+   void SlidingWindow::Advance(float deltaTime)
+   {
+      mBucketTime += deltaTime;
+
+      // the whole window has gone by
+      if (mBucketTime >= GetDuration())
+      {
+         const float bucketTime = std::fmod(mBucketTime, mBucketDuration);
+         Reset();
+         mBucketTime = bucketTime;
+         return;
+      }
+
+      while (mBucketTime >= mBucketDuration)
+      {
+         // the oldest bucket drops out, and is reused for what comes next
+         mBucketTime -= mBucketDuration;
+         mCurrent = (mCurrent + 1) % int(mBuckets.size());
+         mTotal -= mBuckets[mCurrent];
+         mBuckets[mCurrent] = 0.0;
+      }
+   }
+
+   void SlidingWindow::Reset()
+   {
+      mBuckets.assign(mBuckets.size(), 0.0);
+      mBucketTime = 0.0f;
+      mCurrent = 0;
+      mTotal = 0.0;
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -1,4 +1,5 @@
 #include <NetSetGo/NetCore/Socket.h>
+#include <NetSetGo/NetCore/IoUringQueue.h>
 
 #if NET_PLATFORM == NET_PLATFORM_WINDOWS
 #   include <WinSock2.h>
@@ -6,9 +7,62 @@
 #else
 #   include <netdb.h>
 #   include <fcntl.h>
+#   include <unistd.h>
+#   define SOCKET_ERROR -1
 #endif
 
+#if NET_PLATFORM == NET_PLATFORM_UNIX && defined(__linux__)
+#   define NET_SOCKET_MMSG 1 // recvmmsg() and sendmmsg() are available
+#   include <netinet/udp.h>
+#   include <errno.h>
+#else
+#   define NET_SOCKET_MMSG 0
+#endif
+
+#if NET_SOCKET_MMSG && defined(UDP_SEGMENT)
+#   define NET_SOCKET_GSO 1 // the kernel can split one send into many datagrams
+#else
+#   define NET_SOCKET_GSO 0
+#endif
+
+#if NET_SOCKET_MMSG && defined(UDP_GRO)
+#   define NET_SOCKET_GRO 1 // the kernel can coalesce received datagrams
+#else
+#   define NET_SOCKET_GRO 0
+#endif
+
+#if NET_SOCKET_MMSG && defined(SO_TIMESTAMPING)
+#   define NET_SOCKET_TIMESTAMPING 1 // the kernel can stamp received datagrams
+#   include <linux/net_tstamp.h>
+#   include <linux/errqueue.h>
+#else
+#   define NET_SOCKET_TIMESTAMPING 0
+#endif
+
+#if NET_SOCKET_MMSG && defined(SO_RXQ_OVFL)
+#   define NET_SOCKET_RXQ_OVFL 1 // the kernel can tell us how many datagrams it dropped
+#else
+#   define NET_SOCKET_RXQ_OVFL 0
+#endif
+
+#if NET_SOCKET_MMSG && defined(SO_BUSY_POLL)
+#   define NET_SOCKET_BUSY_POLL 1 // the kernel can poll the device for a blocked receive
+#else
+#   define NET_SOCKET_BUSY_POLL 0
+#endif
+
+#if NET_PLATFORM != NET_PLATFORM_WINDOWS
+#   include <time.h>
+#endif
+
+// auto-tuning stops doubling buffers past this
+static const int kMaxAutoBufferSize = 8 * 1024 * 1024;
+
+// how long a busy-polling receive spins on the device by default, in microseconds
+static const int kDefaultBusyPollTime = 50;
+
 #include <cassert>
+#include <cstring>
 #include <stdio.h>
 
 #if NET_PLATFORM == NET_PLATFORM_WINDOWS
@@ -20,6 +74,7 @@ typedef int SocketInternalType;
 ////////////////////////////////////////////////////////////////////////////////
 
 static bool sgSocketsInitialized = false;
+static unsigned int sgSocketSerial = 0;
 
 bool net::InitializeSockets()
 {
@@ -62,6 +117,14 @@ void net::ShutdownSockets()
 
 net::Socket::Socket(int options)
    : mPort(0)
+   , mSerial(0)
+   , mQueue(NULL)
+   , mSegmentOffload(true)
+   , mReceiveBufferSize(0)
+   , mSendBufferSize(0)
+   , mBusyPollTime(kDefaultBusyPollTime)
+   , mReceiveDrops(0)
+   , mSendDrops(0)
 {
    mOptions = options;
 #if NET_PLATFORM == NET_PLATFORM_WINDOWS
@@ -91,6 +154,38 @@ bool net::Socket::Open(unsigned short port)
       return false;
    }
 
+   // let other sockets bind the same port, the kernel spreading senders among
+   // them by address (this has to happen before binding)
+
+   if (mOptions & LoadBalance)
+   {
+#if NET_SOCKET_MMSG && defined(SO_REUSEPORT)
+      int enable = 1;
+      if (setsockopt(mSocket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0)
+      {
+         printf("failed to set socket to load balance\n");
+         Close();
+         return false;
+      }
+#else
+      printf("load balanced sockets are not supported on this platform\n");
+      Close();
+      return false;
+#endif
+   }
+
+   // set reuse port to on to allow multiple binds per host (this too has to happen before binding)
+   if (mOptions & AllowMultiBind)
+   {
+      int enable = 1;
+      if ((setsockopt(SocketInternalType(mSocket), SOL_SOCKET, SO_REUSEADDR, (char*)&enable, sizeof(enable))) < 0)
+      {
+         printf("failed to set socket to allow multiple binds\n");
+         Close();
+         return false;
+      }
+   }
+
    // bind to port
 
    sockaddr_in address;
@@ -146,22 +241,93 @@ bool net::Socket::Open(unsigned short port)
       }
    }
 
-   // set reuse port to on to allow multiple binds per host
-   if (mOptions & AllowMultiBind)
+   // buffer sizes are only a request; the system may cap them
+
+   if (mReceiveBufferSize > 0)
+   {
+      setsockopt(SocketInternalType(mSocket), SOL_SOCKET, SO_RCVBUF, (const char*)&mReceiveBufferSize, sizeof(mReceiveBufferSize));
+   }
+   if (mSendBufferSize > 0)
+   {
+      setsockopt(SocketInternalType(mSocket), SOL_SOCKET, SO_SNDBUF, (const char*)&mSendBufferSize, sizeof(mSendBufferSize));
+   }
+   mReceiveDrops = 0;
+   mSendDrops = 0;
+
+#if NET_SOCKET_RXQ_OVFL
+   // have the kernel's count of dropped datagrams come with each one received
    {
       int enable = 1;
-      if ((setsockopt(SocketInternalType(mSocket), SOL_SOCKET, SO_REUSEADDR, (char*)&enable, sizeof(enable))) < 0)
+      setsockopt(mSocket, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable));
+   }
+#endif
+
+   // receive offload is an optimization, so carry on without it if need be
+   if (mOptions & ReceiveOffload)
+   {
+#if NET_SOCKET_GRO
+      int enable = 1;
+      if (setsockopt(mSocket, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) < 0)
       {
-         printf("failed to set socket to allow multiple binds\n");
-         return false;
+         mOptions &= ~ReceiveOffload;
       }
+#else
+      mOptions &= ~ReceiveOffload;
+#endif
    }
 
+   // as are timestamps: without them, callers fall back on reading the clock
+   if (mOptions & Timestamps)
+   {
+#if NET_SOCKET_TIMESTAMPING
+      int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+      if (setsockopt(mSocket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+      {
+         mOptions &= ~Timestamps;
+      }
+#else
+      mOptions &= ~Timestamps;
+#endif
+   }
+
+#if NET_PLATFORM == NET_PLATFORM_UNIX
+   // busy polling needs CAP_NET_ADMIN to go past the system's own setting
+   // (net.core.busy_read), so it is another thing to carry on without
+   if (mOptions & BusyPoll)
+   {
+#if NET_SOCKET_BUSY_POLL
+      if (mBusyPollTime <= 0 || setsockopt(mSocket, SOL_SOCKET, SO_BUSY_POLL, &mBusyPollTime, sizeof(mBusyPollTime)) < 0)
+      {
+         mOptions &= ~BusyPoll;
+      }
+#else
+      mOptions &= ~BusyPoll;
+#endif
+   }
+
+   // io_uring is an optimization, so carry on with plain system calls without it
+   if (mOptions & IoUring)
+   {
+      mQueue = new IoUringQueue();
+      if (!mQueue->Start(mSocket, UsesReceiveOffload(), UsesTimestamps()))
+      {
+         delete mQueue;
+         mQueue = NULL;
+      }
+   }
+#endif
+
+   mSerial = ++sgSocketSerial;
+
    return true;
 }
 
 void net::Socket::Close()
 {
+   delete mQueue;
+   mQueue = NULL;
+   mPeer = Address();
+
    if (IsOpen())
    {
 #if NET_PLATFORM == NET_PLATFORM_MAC || NET_PLATFORM == NET_PLATFORM_UNIX
@@ -183,6 +349,31 @@ bool net::Socket::IsOpen() const
 #endif
 }
 
+bool net::Socket::Connect(const net::Address& peer)
+{
+   assert(peer.GetAddress() != 0);
+   assert(peer.GetPort() != 0);
+
+   if (!IsOpen())
+   {
+      return false;
+   }
+
+   sockaddr_in address;
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(peer.GetAddress());
+   address.sin_port = htons((unsigned short)peer.GetPort());
+
+   if (connect(SocketInternalType(mSocket), (const sockaddr*)&address, sizeof(sockaddr_in)) < 0)
+   {
+      printf("failed to connect socket\n");
+      return false;
+   }
+
+   mPeer = peer;
+   return true;
+}
+
 bool net::Socket::Send(const net::Address& destination, const void* data, int size)
 {
    assert(data);
@@ -201,8 +392,86 @@ bool net::Socket::Send(const net::Address& destination, const void* data, int si
    address.sin_addr.s_addr = htonl(destination.GetAddress());
    address.sin_port = htons((unsigned short)destination.GetPort());
 
-   const int sent_bytes = sendto(SocketInternalType(mSocket), (const char*)data, size, 0, (sockaddr*)&address, sizeof(sockaddr_in));
+   // a connected socket already knows where its datagrams go, and skips looking up the route
+   const bool connected = destination == mPeer;
+   const int sent_bytes = sendto(SocketInternalType(mSocket), (const char*)data, size, 0,
+      connected ? NULL : (sockaddr*)&address, connected ? 0 : sizeof(sockaddr_in));
+   const bool success = sent_bytes == size;
+   if (!success && OutOfBufferSpace())
+   {
+      DroppedSends(1);
+   }
+
+   return success;
+}
+
+bool net::Socket::SendV(const net::Address& destination, const Buffer buffers[], int count)
+{
+   assert(buffers);
+   assert(count > 0);
+
+   if (!IsOpen())
+   {
+      return false;
+   }
+
+   assert(destination.GetAddress() != 0);
+   assert(destination.GetPort() != 0);
+
+   sockaddr_in address;
+   address.sin_family = AF_INET;
+   address.sin_addr.s_addr = htonl(destination.GetAddress());
+   address.sin_port = htons((unsigned short)destination.GetPort());
+
+   // a header and a payload is the usual case, so a handful is plenty
+   const int kMaxBuffers = 8;
+   assert(count <= kMaxBuffers);
+   if (count > kMaxBuffers)
+   {
+      return false;
+   }
+
+   int size = 0;
+#if NET_PLATFORM == NET_PLATFORM_WINDOWS
+   WSABUF vectors[kMaxBuffers];
+   for (int i = 0; i < count; ++i)
+   {
+      vectors[i].buf = (CHAR*)buffers[i].mData;
+      vectors[i].len = ULONG(buffers[i].mSize);
+      size += buffers[i].mSize;
+   }
+
+   DWORD sent_bytes = 0;
+   const bool connected = destination == mPeer;
+   const int result = WSASendTo(SocketInternalType(mSocket), vectors, DWORD(count), &sent_bytes, 0,
+      connected ? NULL : (sockaddr*)&address, connected ? 0 : sizeof(sockaddr_in), NULL, NULL);
+   const bool success = result == 0 && int(sent_bytes) == size;
+#else
+   iovec vectors[kMaxBuffers];
+   for (int i = 0; i < count; ++i)
+   {
+      vectors[i].iov_base = const_cast<void*>(buffers[i].mData);
+      vectors[i].iov_len = buffers[i].mSize;
+      size += buffers[i].mSize;
+   }
+
+   msghdr message;
+   memset(&message, 0, sizeof(message));
+   if (destination != mPeer)
+   {
+      message.msg_name = &address;
+      message.msg_namelen = sizeof(sockaddr_in);
+   }
+   message.msg_iov = vectors;
+   message.msg_iovlen = count;
+
+   const int sent_bytes = int(sendmsg(SocketInternalType(mSocket), &message, 0));
    const bool success = sent_bytes == size;
+#endif
+   if (!success && OutOfBufferSpace())
+   {
+      DroppedSends(1);
+   }
 
    return success;
 }
@@ -221,10 +490,56 @@ int net::Socket::Receive(net::Address& sender, void* data, int size)
    typedef int socklen_t;
 #endif
 
+   // the posted io_uring receive gets to everything first
+   if (UsesIoUring())
+   {
+      Datagram datagram;
+      int received_bytes = 0;
+      if (mQueue->Receive(&datagram, 1, !(mOptions & NonBlocking)) == 1)
+      {
+         received_bytes = datagram.mSize < size ? datagram.mSize : size;
+         memcpy(data, datagram.mData, received_bytes);
+         sender = datagram.mAddress;
+      }
+      mQueue->Release();
+      DroppedReceives(mQueue->GetReceiveDrops());
+      return received_bytes;
+   }
+
    sockaddr_in from;
+#if NET_SOCKET_RXQ_OVFL
+   // recvmsg() rather than recvfrom() so the kernel's drop count comes along
+   iovec vector;
+   vector.iov_base = data;
+   vector.iov_len = size;
+   char control[128];
+   const int controlSize = GetControlSize(UsesReceiveOffload(), UsesTimestamps());
+   assert(controlSize <= int(sizeof(control)));
+   msghdr header;
+   memset(&header, 0, sizeof(header));
+   header.msg_name = &from;
+   header.msg_namelen = sizeof(from);
+   header.msg_iov = &vector;
+   header.msg_iovlen = 1;
+   header.msg_control = control;
+   header.msg_controllen = controlSize;
+
+   int received_bytes = recvmsg(mSocket, &header, 0);
+   if (received_bytes > 0)
+   {
+      Datagram datagram; // only the drop count is wanted from it
+      datagram.mSize = received_bytes;
+      datagram.mSegmentSize = received_bytes;
+      datagram.mTime = 0.0;
+      unsigned int receiveDrops = mReceiveDrops;
+      ReadControl(&header, datagram, receiveDrops);
+      DroppedReceives(receiveDrops);
+   }
+#else
    socklen_t fromLength = sizeof(from);
 
    int received_bytes = recvfrom(SocketInternalType(mSocket), (char*)data, size, 0, (sockaddr*)&from, &fromLength);
+#endif
 
    if (received_bytes == SOCKET_ERROR)
    {
@@ -244,6 +559,500 @@ int net::Socket::Receive(net::Address& sender, void* data, int size)
    return received_bytes;
 }
 
+int net::Socket::SendBatch(const Datagram datagrams[], int count)
+{
+   assert(datagrams || count == 0);
+
+   if (!IsOpen())
+   {
+      return 0;
+   }
+
+   if (UsesIoUring())
+   {
+      const unsigned int sendDrops = mQueue->GetSendDrops();
+      const int sent = mQueue->Send(datagrams, count);
+      DroppedSends(mQueue->GetSendDrops() - sendDrops);
+      return sent;
+   }
+
+   int sent = 0;
+
+#if NET_SOCKET_MMSG
+   // sendmmsg() stops at the first datagram that fails, so we skip over that
+   // one (just as a failed sendto() would lose it) and carry on with the rest
+   const int kMaxBatch = 64;
+   mmsghdr messages[kMaxBatch];
+   iovec vectors[kMaxBatch];
+   sockaddr_in addresses[kMaxBatch];
+
+   int index = 0;
+   while (index < count)
+   {
+      const int batchSize = (count - index) < kMaxBatch ? (count - index) : kMaxBatch;
+      for (int i = 0; i < batchSize; ++i)
+      {
+         const Datagram& datagram = datagrams[index + i];
+         assert(datagram.mData);
+         assert(datagram.mSize > 0);
+         assert(datagram.mAddress.GetAddress() != 0);
+         assert(datagram.mAddress.GetPort() != 0);
+
+         addresses[i].sin_family = AF_INET;
+         addresses[i].sin_addr.s_addr = htonl(datagram.mAddress.GetAddress());
+         addresses[i].sin_port = htons((unsigned short)datagram.mAddress.GetPort());
+         vectors[i].iov_base = datagram.mData;
+         vectors[i].iov_len = datagram.mSize;
+         memset(&messages[i], 0, sizeof(messages[i]));
+         if (datagram.mAddress != mPeer)
+         {
+            messages[i].msg_hdr.msg_name = &addresses[i];
+            messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+         }
+         messages[i].msg_hdr.msg_iov = &vectors[i];
+         messages[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      const int result = sendmmsg(mSocket, messages, batchSize, 0);
+      if (result > 0)
+      {
+         sent += result;
+         index += result;
+      }
+      else
+      {
+         if (OutOfBufferSpace())
+         {
+            DroppedSends(1);
+         }
+         ++index;
+      }
+   }
+#else
+   for (int i = 0; i < count; ++i)
+   {
+      if (Send(datagrams[i].mAddress, datagrams[i].mData, datagrams[i].mSize))
+      {
+         ++sent;
+      }
+   }
+#endif
+
+   return sent;
+}
+
+int net::Socket::SendSegments(const net::Address& destination, const void* data, int size, int segmentSize)
+{
+   assert(data);
+   assert(size > 0);
+   assert(segmentSize > 0);
+
+   if (!IsOpen())
+   {
+      return 0;
+   }
+
+   const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+   const int numSegments = (size + segmentSize - 1) / segmentSize;
+   int sent = 0;
+
+#if NET_SOCKET_GSO
+   // the kernel takes at most 64 segments, and no more than a maximum size
+   // datagram's worth of bytes, per send
+   const int kMaxSegments = 64;
+   const int kMaxBytes = 65507;
+   const int segmentsPerSend = kMaxBytes / segmentSize < kMaxSegments ? kMaxBytes / segmentSize : kMaxSegments;
+
+   if (numSegments > 1 && segmentsPerSend > 1 && mSegmentOffload)
+   {
+      assert(destination.GetAddress() != 0);
+      assert(destination.GetPort() != 0);
+
+      sockaddr_in address;
+      address.sin_family = AF_INET;
+      address.sin_addr.s_addr = htonl(destination.GetAddress());
+      address.sin_port = htons((unsigned short)destination.GetPort());
+
+      while (sent < numSegments)
+      {
+         const int offset = sent * segmentSize;
+         const int chunkSegments = (numSegments - sent) < segmentsPerSend ? (numSegments - sent) : segmentsPerSend;
+         const int chunkSize = (size - offset) < chunkSegments * segmentSize ? (size - offset) : chunkSegments * segmentSize;
+
+         iovec vector;
+         vector.iov_base = const_cast<unsigned char*>(&bytes[offset]);
+         vector.iov_len = chunkSize;
+
+         char control[CMSG_SPACE(sizeof(unsigned short))];
+         memset(control, 0, sizeof(control));
+
+         msghdr message;
+         memset(&message, 0, sizeof(message));
+         if (destination != mPeer)
+         {
+            message.msg_name = &address;
+            message.msg_namelen = sizeof(sockaddr_in);
+         }
+         message.msg_iov = &vector;
+         message.msg_iovlen = 1;
+         message.msg_control = control;
+         message.msg_controllen = sizeof(control);
+
+         cmsghdr* header = CMSG_FIRSTHDR(&message);
+         header->cmsg_level = SOL_UDP;
+         header->cmsg_type = UDP_SEGMENT;
+         header->cmsg_len = CMSG_LEN(sizeof(unsigned short));
+         const unsigned short gsoSize = (unsigned short)segmentSize;
+         memcpy(CMSG_DATA(header), &gsoSize, sizeof(gsoSize));
+
+         const ssize_t result = sendmsg(mSocket, &message, 0);
+         if (result == chunkSize)
+         {
+            sent += chunkSegments;
+         }
+         else if (errno == EIO || errno == EINVAL || errno == ENOPROTOOPT || errno == EOPNOTSUPP)
+         {
+            // no offload on this kernel or device; send the rest below
+            mSegmentOffload = false;
+            break;
+         }
+         else
+         {
+            if (OutOfBufferSpace())
+            {
+               DroppedSends(numSegments - sent);
+            }
+            return sent; // the socket buffer is full (or worse), so drop the rest as sendto() would
+         }
+      }
+   }
+#endif
+
+   for (; sent < numSegments; ++sent)
+   {
+      const int offset = sent * segmentSize;
+      const int segment = (size - offset) < segmentSize ? (size - offset) : segmentSize;
+      if (!Send(destination, &bytes[offset], segment))
+      {
+         break;
+      }
+   }
+
+   return sent;
+}
+
+int net::Socket::ReceiveBatch(Datagram datagrams[], int count)
+{
+   assert(datagrams || count == 0);
+
+   if (!IsOpen())
+   {
+      return 0;
+   }
+
+   int received = 0;
+
+   if (UsesIoUring())
+   {
+      // the caller wants its own buffers filled, so copy out of the queue's
+      const int kMaxBatch = 64;
+      Datagram inPlace[kMaxBatch];
+      while (received < count)
+      {
+         const int batchSize = (count - received) < kMaxBatch ? (count - received) : kMaxBatch;
+         const int result = mQueue->Receive(inPlace, batchSize, received == 0 && !(mOptions & NonBlocking));
+         for (int i = 0; i < result; ++i)
+         {
+            Datagram& datagram = datagrams[received + i];
+            assert(datagram.mData);
+            datagram.mAddress = inPlace[i].mAddress;
+            datagram.mSize = inPlace[i].mSize <= datagram.mSize ? inPlace[i].mSize : 0;
+            datagram.mSegmentSize = datagram.mSize > 0 ? inPlace[i].mSegmentSize : 0;
+            datagram.mTime = inPlace[i].mTime;
+            memcpy(datagram.mData, inPlace[i].mData, datagram.mSize);
+         }
+         mQueue->Release();
+         DroppedReceives(mQueue->GetReceiveDrops());
+         received += result;
+
+         if (result < batchSize)
+         {
+            break; // drained
+         }
+      }
+      return received;
+   }
+
+#if NET_SOCKET_MMSG
+   const int kMaxBatch = 64;
+   mmsghdr messages[kMaxBatch];
+   iovec vectors[kMaxBatch];
+   sockaddr_in addresses[kMaxBatch];
+   // room for the segment size of a coalesced datagram, and the time it arrived
+   const int kMaxControlSize = 128;
+   const int controlSize = GetControlSize(UsesReceiveOffload(), UsesTimestamps());
+   assert(controlSize <= kMaxControlSize);
+   char controls[kMaxBatch][kMaxControlSize];
+
+   unsigned int receiveDrops = mReceiveDrops;
+   while (received < count)
+   {
+      const int batchSize = (count - received) < kMaxBatch ? (count - received) : kMaxBatch;
+      for (int i = 0; i < batchSize; ++i)
+      {
+         Datagram& datagram = datagrams[received + i];
+         assert(datagram.mData);
+         assert(datagram.mSize > 0);
+
+         vectors[i].iov_base = datagram.mData;
+         vectors[i].iov_len = datagram.mSize;
+         memset(&messages[i], 0, sizeof(messages[i]));
+         messages[i].msg_hdr.msg_name = &addresses[i];
+         messages[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+         messages[i].msg_hdr.msg_iov = &vectors[i];
+         messages[i].msg_hdr.msg_iovlen = 1;
+         if (controlSize > 0)
+         {
+            messages[i].msg_hdr.msg_control = controls[i];
+            messages[i].msg_hdr.msg_controllen = controlSize;
+         }
+      }
+
+      // MSG_WAITFORONE: only the first datagram may block (on a blocking socket)
+      const int result = recvmmsg(mSocket, messages, batchSize, MSG_WAITFORONE, NULL);
+      if (result <= 0)
+      {
+         break;
+      }
+
+      for (int i = 0; i < result; ++i)
+      {
+         Datagram& datagram = datagrams[received + i];
+         datagram.mAddress = Address(ntohl(addresses[i].sin_addr.s_addr), ntohs(addresses[i].sin_port));
+         // drop anything that did not fit rather than hand out a partial datagram
+         datagram.mSize = (messages[i].msg_hdr.msg_flags & MSG_TRUNC) ? 0 : int(messages[i].msg_len);
+         datagram.mSegmentSize = datagram.mSize;
+         datagram.mTime = 0.0;
+         ReadControl(&messages[i].msg_hdr, datagram, receiveDrops);
+      }
+      received += result;
+
+      if (result < batchSize)
+      {
+         break; // drained
+      }
+   }
+   DroppedReceives(receiveDrops);
+#else
+   while (received < count)
+   {
+      Datagram& datagram = datagrams[received];
+      datagram.mSize = Receive(datagram.mAddress, datagram.mData, datagram.mSize);
+      datagram.mSegmentSize = datagram.mSize;
+      datagram.mTime = 0.0;
+      if (datagram.mSize == 0)
+      {
+         break;
+      }
+      ++received;
+   }
+#endif
+
+   return received;
+}
+
+double net::Socket::GetTime()
+{
+#if NET_PLATFORM == NET_PLATFORM_WINDOWS
+   LARGE_INTEGER frequency, counter;
+   QueryPerformanceFrequency(&frequency);
+   QueryPerformanceCounter(&counter);
+   return double(counter.QuadPart) / double(frequency.QuadPart);
+#else
+   // software timestamps are taken on the real time clock
+   timespec now;
+   clock_gettime(CLOCK_REALTIME, &now);
+   return double(now.tv_sec) + double(now.tv_nsec) / 1000000000.0;
+#endif
+}
+
+int net::Socket::GetControlSize(bool coalesced, bool timestamped)
+{
+   int size = 0;
+#if NET_SOCKET_GRO
+   size += coalesced ? int(CMSG_SPACE(sizeof(int))) : 0;
+#endif
+#if NET_SOCKET_TIMESTAMPING
+   size += timestamped ? int(CMSG_SPACE(sizeof(scm_timestamping))) : 0;
+#endif
+#if NET_SOCKET_RXQ_OVFL
+   size += int(CMSG_SPACE(sizeof(unsigned int)));
+#endif
+   (void)coalesced;
+   (void)timestamped;
+   return size;
+}
+
+void net::Socket::ReadControl(void* header, Datagram& datagram, unsigned int& receiveDrops)
+{
+#if NET_SOCKET_MMSG
+   msghdr* message = reinterpret_cast<msghdr*>(header);
+   for (cmsghdr* control = CMSG_FIRSTHDR(message); control; control = CMSG_NXTHDR(message, control))
+   {
+#if NET_SOCKET_GRO
+      // the segment size of a coalesced datagram
+      if (control->cmsg_level == SOL_UDP && control->cmsg_type == UDP_GRO)
+      {
+         int segmentSize = 0;
+         memcpy(&segmentSize, CMSG_DATA(control), sizeof(segmentSize));
+         datagram.mSegmentSize = segmentSize > 0 ? segmentSize : datagram.mSize;
+      }
+#endif
+#if NET_SOCKET_TIMESTAMPING
+      // the software stamp comes first, the (raw) hardware one last
+      if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_TIMESTAMPING)
+      {
+         scm_timestamping stamps;
+         memcpy(&stamps, CMSG_DATA(control), sizeof(stamps));
+         datagram.mTime = double(stamps.ts[0].tv_sec) + double(stamps.ts[0].tv_nsec) / 1000000000.0;
+      }
+#endif
+#if NET_SOCKET_RXQ_OVFL
+      // how many datagrams the socket had dropped when this one was queued
+      if (control->cmsg_level == SOL_SOCKET && control->cmsg_type == SO_RXQ_OVFL)
+      {
+         unsigned int drops = 0;
+         memcpy(&drops, CMSG_DATA(control), sizeof(drops));
+         receiveDrops = drops > receiveDrops ? drops : receiveDrops;
+      }
+#endif
+   }
+#else
+   (void)header;
+   (void)datagram;
+   (void)receiveDrops;
+#endif
+}
+
+void net::Socket::SetBufferSizes(int receiveSize, int sendSize)
+{
+   assert(receiveSize >= 0);
+   assert(sendSize >= 0);
+   mReceiveBufferSize = receiveSize;
+   mSendBufferSize = sendSize;
+}
+
+int net::Socket::GetReceiveBufferSize() const
+{
+   int size = 0;
+   socklen_t length = sizeof(size);
+   if (!IsOpen() || getsockopt(SocketInternalType(mSocket), SOL_SOCKET, SO_RCVBUF, (char*)&size, &length) < 0)
+   {
+      return 0;
+   }
+   return size;
+}
+
+int net::Socket::GetSendBufferSize() const
+{
+   int size = 0;
+   socklen_t length = sizeof(size);
+   if (!IsOpen() || getsockopt(SocketInternalType(mSocket), SOL_SOCKET, SO_SNDBUF, (char*)&size, &length) < 0)
+   {
+      return 0;
+   }
+   return size;
+}
+
+bool net::Socket::OutOfBufferSpace()
+{
+#if NET_PLATFORM == NET_PLATFORM_WINDOWS
+   const int error = WSAGetLastError();
+   return error == WSAEWOULDBLOCK || error == WSAENOBUFS;
+#else
+   return errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS;
+#endif
+}
+
+void net::Socket::DroppedSends(unsigned int count)
+{
+   if (count > 0)
+   {
+      mSendDrops += count;
+      if (mOptions & AutoTuneBuffers)
+      {
+         GrowBuffer(SO_SNDBUF);
+      }
+   }
+}
+
+void net::Socket::DroppedReceives(unsigned int receiveDrops)
+{
+   if (receiveDrops > mReceiveDrops)
+   {
+      mReceiveDrops = receiveDrops;
+      if (mOptions & AutoTuneBuffers)
+      {
+         GrowBuffer(SO_RCVBUF);
+      }
+   }
+}
+
+bool net::Socket::GrowBuffer(int option)
+{
+   const int size = option == SO_RCVBUF ? GetReceiveBufferSize() : GetSendBufferSize();
+   if (size <= 0 || size >= kMaxAutoBufferSize)
+   {
+      return false;
+   }
+
+#if defined(__linux__)
+   // Linux reports twice what was asked for (the rest is for its bookkeeping),
+   // so asking for what it reports doubles the buffer
+   int request = size;
+#else
+   int request = size * 2;
+#endif
+   if (setsockopt(SocketInternalType(mSocket), SOL_SOCKET, option, (const char*)&request, sizeof(request)) < 0)
+   {
+      return false;
+   }
+
+   const int grown = option == SO_RCVBUF ? GetReceiveBufferSize() : GetSendBufferSize();
+   if (grown > size)
+   {
+      printf("grew socket %s buffer to %d bytes\n", option == SO_RCVBUF ? "receive" : "send", grown);
+   }
+   return grown > size;
+}
+
+bool net::Socket::UsesIoUring() const
+{
+   return mQueue && mQueue->IsRunning();
+}
+
+int net::Socket::ReceiveInPlace(Datagram datagrams[], int count)
+{
+   assert(datagrams || count == 0);
+
+   if (!IsOpen() || !UsesIoUring())
+   {
+      return 0;
+   }
+
+   const int received = mQueue->Receive(datagrams, count, !(mOptions & NonBlocking));
+   DroppedReceives(mQueue->GetReceiveDrops());
+   return received;
+}
+
+void net::Socket::ReleaseReceived()
+{
+   if (mQueue)
+   {
+      mQueue->Release();
+   }
+}
+
 void net::Socket::ReportLastError()
 {
 #if NET_PLATFORM == NET_PLATFORM_WINDOWS
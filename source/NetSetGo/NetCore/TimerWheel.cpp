@@ -0,0 +1,196 @@
+#include <NetSetGo/NetCore/TimerWheel.h>
+
+#include <cassert>
+#include <cmath>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   TimerWheel::TimerWheel(float resolution, int numTimers)
+      : mResolution(resolution)
+      , mRemainder(0.0f)
+      , mNow(0)
+      , mNumScheduled(0)
+   {
+      assert(mResolution > 0.0f);
+      Reserve(numTimers);
+   }
+
+   TimerWheel::~TimerWheel()
+   {
+   }
+
+   void TimerWheel::Reserve(int numTimers)
+   {
+      assert(numTimers >= 0);
+      mDue.assign(numTimers, 0);
+      mSlots.assign(numTimers, int(kNotScheduled));
+      mNext.assign(numTimers, int(kEnd));
+      mPrev.assign(numTimers, int(kEnd));
+      for (int i = 0; i < kNumLevels * kNumSlots; ++i)
+      {
+         mHeads[i] = kEnd;
+      }
+      mNumScheduled = 0;
+   }
+
+   void TimerWheel::Schedule(int timer, float delay)
+   {
+      assert(timer >= 0 && timer < GetNumTimers());
+      if (IsScheduled(timer))
+      {
+         Remove(timer);
+      }
+
+      // at least a tick away, as the current one has been and gone
+      const float ticks = delay > 0.0f ? std::ceil(delay / mResolution) : 0.0f;
+      mDue[timer] = mNow + (ticks >= 1.0f ? (unsigned long long)ticks : 1);
+      Insert(timer);
+   }
+
+   void TimerWheel::Cancel(int timer)
+   {
+      assert(timer >= 0 && timer < GetNumTimers());
+      if (IsScheduled(timer))
+      {
+         Remove(timer);
+      }
+   }
+
+   void TimerWheel::CancelAll()
+   {
+      Reserve(GetNumTimers());
+   }
+
+   void TimerWheel::Advance(float deltaTime, std::vector<int>& expired)
+   {
+      mRemainder += deltaTime;
+      while (mRemainder >= mResolution)
+      {
+         mRemainder -= mResolution;
+         Tick(expired);
+      }
+   }
+
+   float TimerWheel::GetTimeUntilNext() const
+   {
+      if (mNumScheduled == 0)
+      {
+         return 1.0e9f;
+      }
+
+      // on each level, the first slot with anything in it, counting on from
+      // the current one, starts when the soonest of them can be due; one on
+      // a higher level may be sooner than one on a lower level
+      unsigned long long soonest = ~0ULL;
+      for (int level = 0; level < kNumLevels; ++level)
+      {
+         const int shift = level * kSlotBits;
+         const unsigned long long current = mNow >> shift;
+         for (int i = 1; i <= kNumSlots; ++i)
+         {
+            const unsigned long long slot = current + i;
+            if (mHeads[level * kNumSlots + int(slot & kSlotMask)] != kEnd)
+            {
+               const unsigned long long start = slot << shift;
+               soonest = start < soonest ? start : soonest;
+               break;
+            }
+         }
+      }
+      const float timeUntilNext = float(soonest - mNow) * mResolution - mRemainder;
+      return timeUntilNext > 0.0f ? timeUntilNext : 0.0f;
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+   void TimerWheel::Insert(int timer)
+   {
+      // the lowest level that reaches as far as the timer is due
+      const unsigned long long due = mDue[timer];
+      const unsigned long long ticks = due - mNow;
+      int level = 0;
+      while (level < kNumLevels - 1 && ticks >= (1ULL << ((level + 1) * kSlotBits)))
+      {
+         ++level;
+      }
+      unsigned long long slot = due >> (level * kSlotBits);
+      if (level == kNumLevels - 1 && ticks >= (1ULL << (kNumLevels * kSlotBits)))
+      {
+         slot = (mNow >> (level * kSlotBits)) - 1; // the last slot round, to be looked at again then
+      }
+
+      const int index = level * kNumSlots + int(slot & kSlotMask);
+      mSlots[timer] = index;
+      mPrev[timer] = kEnd;
+      mNext[timer] = mHeads[index];
+      if (mHeads[index] != kEnd)
+      {
+         mPrev[mHeads[index]] = timer;
+      }
+      mHeads[index] = timer;
+      ++mNumScheduled;
+   }
+
+   void TimerWheel::Remove(int timer)
+   {
+      const int index = mSlots[timer];
+      assert(index != kNotScheduled);
+      if (mPrev[timer] != kEnd)
+      {
+         mNext[mPrev[timer]] = mNext[timer];
+      }
+      else
+      {
+         mHeads[index] = mNext[timer];
+      }
+      if (mNext[timer] != kEnd)
+      {
+         mPrev[mNext[timer]] = mPrev[timer];
+      }
+      mSlots[timer] = kNotScheduled;
+      mNext[timer] = kEnd;
+      mPrev[timer] = kEnd;
+      --mNumScheduled;
+   }
+
+   void TimerWheel::Tick(std::vector<int>& expired)
+   {
+      ++mNow;
+
+      // as each level comes round, the slot of the one above that is now
+      // within its reach moves down into it
+      for (int level = 1; level < kNumLevels; ++level)
+      {
+         const int shift = level * kSlotBits;
+         if ((mNow & ((1ULL << shift) - 1)) != 0)
+         {
+            break;
+         }
+         const int index = level * kNumSlots + int((mNow >> shift) & kSlotMask);
+         int timer = mHeads[index];
+         while (timer != kEnd)
+         {
+            const int next = mNext[timer];
+            Remove(timer);
+            assert(mDue[timer] >= mNow);
+            Insert(timer);
+            timer = next;
+         }
+      }
+
+      // everything in the current slot of the first level is due now
+      const int index = int(mNow & kSlotMask);
+      while (mHeads[index] != kEnd)
+      {
+         const int timer = mHeads[index];
+         assert(mDue[timer] == mNow);
+         Remove(timer);
+         expired.push_back(timer);
+      }
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
@@ -0,0 +1,102 @@
+#include <NetSetGo/NetCore/Transport.h>
+
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+namespace net {
+
+////////////////////////////////////////////////////////////////////////////////
+
+   Transport::~Transport()
+   {
+   }
+
+   bool Transport::SendV(const net::Address& destination, const Buffer buffers[], int count)
+   {
+      assert(buffers);
+      assert(count > 0);
+
+      // with nothing better, copy the pieces together
+      int size = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         size += buffers[i].mSize;
+      }
+
+      std::vector<unsigned char> packet(size > 0 ? size : 1);
+      int offset = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         memcpy(&packet[offset], buffers[i].mData, buffers[i].mSize);
+         offset += buffers[i].mSize;
+      }
+
+      return Send(destination, &packet[0], size);
+   }
+
+   int Transport::SendBatch(const Datagram datagrams[], int count)
+   {
+      assert(datagrams || count == 0);
+
+      int sent = 0;
+      for (int i = 0; i < count; ++i)
+      {
+         if (Send(datagrams[i].mAddress, datagrams[i].mData, datagrams[i].mSize))
+         {
+            ++sent;
+         }
+      }
+      return sent;
+   }
+
+   int Transport::ReceiveBatch(Datagram datagrams[], int count)
+   {
+      assert(datagrams || count == 0);
+
+      int received = 0;
+      while (received < count)
+      {
+         Datagram& datagram = datagrams[received];
+         datagram.mSize = Receive(datagram.mAddress, datagram.mData, datagram.mSize);
+         datagram.mSegmentSize = datagram.mSize;
+         datagram.mTime = 0.0;
+         if (datagram.mSize <= 0)
+         {
+            datagram.mSize = 0;
+            break;
+         }
+         ++received;
+      }
+      return received;
+   }
+
+   int Transport::SendSegments(const net::Address& destination, const void* data, int size, int segmentSize)
+   {
+      assert(data);
+      assert(size > 0);
+      assert(segmentSize > 0);
+
+      const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+      int sent = 0;
+      for (int offset = 0; offset < size; offset += segmentSize)
+      {
+         const int chunkSize = (size - offset) < segmentSize ? (size - offset) : segmentSize;
+         if (Send(destination, &bytes[offset], chunkSize))
+         {
+            ++sent;
+         }
+      }
+      return sent;
+   }
+
+   int Transport::ReceiveInPlace(Datagram datagrams[], int count)
+   {
+      (void)datagrams;
+      (void)count;
+      return 0;
+   }
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace net
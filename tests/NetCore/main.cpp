@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <set>
 #include <vector>
 
 #include <OpenThreads/Thread> // for sleeping in loops
@@ -62,6 +63,67 @@ void testAddress()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <NetSetGo/NetCore/AddressMap.h>
+
+void testAddressMap()
+{
+   net::AddressMap map;
+   test_assert(map.IsEmpty());
+   test_assert(map.Find(net::Address(1, 2, 3, 4, 5)) == net::NODEID_INVALID);
+   test_assert(!map.Erase(net::Address(1, 2, 3, 4, 5)));
+
+   map.Insert(net::Address(1, 2, 3, 4, 5), 7);
+   test_assert(map.GetSize() == 1);
+   test_assert(map.Find(net::Address(1, 2, 3, 4, 5)) == 7);
+   test_assert(map.Find(net::Address(1, 2, 3, 4, 6)) == net::NODEID_INVALID); // the port counts too
+   map.Insert(net::Address(1, 2, 3, 4, 5), 8);
+   test_assert(map.GetSize() == 1);
+   test_assert(map.Find(net::Address(1, 2, 3, 4, 5)) == 8);
+
+   // grow well past the first few groups, with addresses differing only by port
+   // as well as by address
+   const int kNumAddresses = 1000;
+   for (int i = 0; i < kNumAddresses; ++i)
+   {
+      map.Insert(net::Address(10, 0, (unsigned char)(i >> 8), (unsigned char)i, (unsigned short)(5000 + i % 2)), i);
+   }
+   test_assert(map.GetSize() == 1 + kNumAddresses);
+   test_assert(map.GetCapacity() * 7 >= map.GetSize() * 8);
+   for (int i = 0; i < kNumAddresses; ++i)
+   {
+      test_assert(map.Find(net::Address(10, 0, (unsigned char)(i >> 8), (unsigned char)i, (unsigned short)(5000 + i % 2))) == i);
+      test_assert(map.Find(net::Address(10, 0, (unsigned char)(i >> 8), (unsigned char)i, (unsigned short)(5001 - i % 2))) == net::NODEID_INVALID);
+   }
+
+   // erasing leaves the rest to be found, and erased addresses can come back
+   for (int i = 0; i < kNumAddresses; i += 2)
+   {
+      test_assert(map.Erase(net::Address(10, 0, (unsigned char)(i >> 8), (unsigned char)i, 5000)));
+   }
+   test_assert(map.GetSize() == 1 + kNumAddresses / 2);
+   const int capacity = map.GetCapacity();
+   for (int round = 0; round < 4; ++round)
+   {
+      for (int i = 0; i < kNumAddresses; ++i)
+      {
+         const net::Address address(10, 0, (unsigned char)(i >> 8), (unsigned char)i, (unsigned short)(5000 + i % 2));
+         test_assert(map.Find(address) == (i % 2 == 0 ? net::NODEID_INVALID : i));
+         if (i % 2 == 0)
+         {
+            map.Insert(address, i);
+            test_assert(map.Erase(address));
+         }
+      }
+   }
+   test_assert(map.GetCapacity() == capacity); // churn alone does not grow the table
+
+   map.Clear();
+   test_assert(map.IsEmpty());
+   test_assert(map.Find(net::Address(1, 2, 3, 4, 5)) == net::NODEID_INVALID);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 #include <NetSetGo/NetCore/Beacon.h>
 
 void testBeaconHeader()
@@ -235,7 +297,574 @@ void testBeacon()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// todo: write Mesh unit tests
+#include <NetSetGo/NetCore/ImpairedTransport.h>
+#include <NetSetGo/NetCore/SharedMemoryTransport.h>
+#include <NetSetGo/NetCore/Mesh.h>
+#include <NetSetGo/NetCore/Node.h>
+
+void testImpairedTransport()
+{
+   const unsigned short kSenderPort   = 1263;
+   const unsigned short kReceiverPort = 1264;
+   const net::Address receiverAddress("127.0.0.1", kReceiverPort);
+
+   net::SharedMemoryTransport senderTransport, receiver;
+   test_assert(receiver.Open(kReceiverPort));
+   const char sendData[100] = { 1, 2, 3 };
+   char recvData[128];
+   net::Address senderAddress;
+
+   // test latency: nothing arrives until its time has come
+   {
+      net::ImpairedTransport::Impairments impairments;
+      impairments.mLatency = 0.1f;
+      net::ImpairedTransport sender(senderTransport, impairments);
+      sender.SetTime(0.0);
+      test_assert(sender.Open(kSenderPort));
+      test_assert(sender.Send(receiverAddress, sendData, sizeof(sendData)));
+      test_assert(sender.GetNumPending() == 1);
+      test_assert(receiver.Receive(senderAddress, recvData, sizeof(recvData)) == 0);
+      sender.SetTime(0.05);
+      test_assert(sender.Flush() == 0);
+      sender.SetTime(impairments.mLatency);
+      test_assert(sender.Flush() == 1);
+      test_assert(receiver.Receive(senderAddress, recvData, sizeof(recvData)) == sizeof(sendData));
+      test_assert(senderAddress == net::Address("127.0.0.1", kSenderPort));
+      sender.Close();
+      test_assert(!senderTransport.IsOpen());
+   }
+
+   // test bandwidth: each datagram takes its turn on the link
+   {
+      net::ImpairedTransport::Impairments impairments;
+      impairments.mBandwidth = 1000; // bytes per second
+      impairments.mQueueSize = 250;
+      net::ImpairedTransport sender(senderTransport, impairments);
+      sender.SetTime(0.0);
+      test_assert(sender.Open(kSenderPort));
+      for (int i = 0; i < 4; ++i)
+      {
+         test_assert(sender.Send(receiverAddress, sendData, sizeof(sendData)));
+      }
+      test_assert(sender.GetNumPending() == 3); // the last found too much waiting ahead of it
+      test_assert(sender.GetNumLost() == 1);
+      sender.SetTime(0.1);
+      test_assert(sender.Flush() == 1);
+      sender.SetTime(0.15);
+      test_assert(sender.Flush() == 0);
+      sender.SetTime(0.35);
+      test_assert(sender.Flush() == 2);
+      net::Transport::Datagram datagrams[8];
+      test_assert(receiver.ReceiveInPlace(datagrams, 8) == 3);
+      receiver.ReleaseReceived();
+      sender.Close();
+   }
+
+   // test loss, duplication and reordering, the same seed always doing the same
+   {
+      net::ImpairedTransport::Impairments impairments;
+      impairments.mLoss = 0.25f;
+      impairments.mDuplication = 0.25f;
+      impairments.mReordering = 0.25f;
+      impairments.mReorderDelay = 0.01f;
+      std::vector<int> arrivals[2];
+      for (int pass = 0; pass < 2; ++pass)
+      {
+         net::ImpairedTransport sender(senderTransport, impairments, 1234);
+         sender.SetTime(0.0);
+         test_assert(sender.Open(kSenderPort));
+         const int kNumDatagrams = 200;
+         for (int i = 0; i < kNumDatagrams; ++i)
+         {
+            test_assert(sender.Send(receiverAddress, &i, sizeof(i)));
+         }
+         sender.SetTime(1.0);
+         sender.Flush();
+         int value = 0;
+         while (receiver.Receive(senderAddress, &value, sizeof(value)) == sizeof(value))
+         {
+            arrivals[pass].push_back(value);
+         }
+
+         test_assert(sender.GetNumLost() > 0 && sender.GetNumLost() < unsigned(kNumDatagrams / 2));
+         test_assert(sender.GetNumDuplicated() > 0);
+         test_assert(sender.GetNumReordered() > 0);
+         test_assert(int(arrivals[pass].size()) == kNumDatagrams - int(sender.GetNumLost()) + int(sender.GetNumDuplicated()));
+         bool inOrder = true;
+         for (size_t i = 1; i < arrivals[pass].size(); ++i)
+         {
+            inOrder = inOrder && arrivals[pass][i - 1] <= arrivals[pass][i];
+         }
+         test_assert(!inOrder);
+         sender.Close();
+      }
+      test_assert(arrivals[0] == arrivals[1]);
+   }
+
+   // test bursty loss: once the link goes bad here, it stays bad
+   {
+      net::ImpairedTransport::Impairments impairments;
+      impairments.mBurstStart = 0.1f;
+      impairments.mBurstLoss = 1.0f;
+      net::ImpairedTransport sender(senderTransport, impairments);
+      test_assert(sender.Open(kSenderPort));
+      int numReceived = 0;
+      for (int i = 0; i < 100; ++i)
+      {
+         test_assert(sender.Send(receiverAddress, &i, sizeof(i)));
+         int value = 0;
+         const bool received = receiver.Receive(senderAddress, &value, sizeof(value)) == sizeof(value);
+         test_assert(!received || numReceived == i); // nothing after the first loss
+         numReceived += received ? 1 : 0;
+      }
+      test_assert(numReceived > 0 && numReceived < 100);
+      test_assert(sender.GetNumLost() == unsigned(100 - numReceived));
+      sender.Close();
+   }
+   receiver.Close();
+
+   // test a node keeping its connection to the mesh over a lossy, laggy link both ways
+   {
+      const unsigned int kProtocolID = 1234;
+      net::ImpairedTransport::Impairments impairments;
+      impairments.mLatency = 0.05f;
+      impairments.mJitter = 0.02f;
+      impairments.mLoss = 0.2f;
+      net::SharedMemoryTransport meshTransport, nodeTransport;
+      net::ImpairedTransport impairedMesh(meshTransport, impairments, 1);
+      net::ImpairedTransport impairedNode(nodeTransport, impairments, 2);
+      net::Mesh mesh(kProtocolID, 4);
+      net::Node node(kProtocolID);
+      mesh.SetTransport(&impairedMesh);
+      node.SetTransport(&impairedNode);
+      test_assert(mesh.Start(kSenderPort));
+      test_assert(node.Start(kReceiverPort));
+      node.Connect(net::Address("127.0.0.1", kSenderPort));
+
+      const float kFrameTime = 0.05f;
+      bool everConnected = false;
+      bool stayedConnected = true;
+      for (int frame = 0; frame < 400; ++frame)
+      {
+         impairedMesh.SetTime(frame * kFrameTime);
+         impairedNode.SetTime(frame * kFrameTime);
+         mesh.Update(kFrameTime);
+         node.Update(kFrameTime);
+         stayedConnected = stayedConnected && (!everConnected || node.IsConnected());
+         everConnected = everConnected || node.IsConnected();
+      }
+      test_assert(everConnected && stayedConnected);
+      const net::NetworkTopology::NodeState* state = mesh.GetNodeByID(node.GetLocalNodeID());
+      test_assert(state);
+      test_assert(state->mReliabilitySystem.GetLostPackets() > 0);
+      test_assert(state->mReliabilitySystem.GetAckedPackets() > state->mReliabilitySystem.GetLostPackets());
+      test_assert(state->mReliabilitySystem.GetSentPacketsPerSecond() > 0.0f && state->mReliabilitySystem.GetReceivedBandwidth() > 0.0f);
+      test_assert(state->mReliabilitySystem.GetLossRate() < 0.5f);
+
+      node.Stop();
+      mesh.Stop();
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/LatencySampler.h>
+
+void testLatencySampler()
+{
+   net::LatencySampler sampler(100);
+   test_assert(sampler.GetNumSamples() == 0);
+   test_assert(sampler.GetPercentile(50.0f) == 0.0);
+
+   // 1 to 100 milliseconds, shuffled
+   for (int i = 0; i < 100; ++i)
+   {
+      sampler.AddSample(((i * 37) % 100 + 1) * 0.001);
+   }
+   test_assert(sampler.GetNumSamples() == 100);
+   test_assert(sampler.GetPercentile(0.0f) == 1 * 0.001);
+   test_assert(sampler.GetPercentile(50.0f) == 50 * 0.001);
+   test_assert(sampler.GetPercentile(99.0f) == 99 * 0.001);
+   test_assert(sampler.GetPercentile(100.0f) == 100 * 0.001);
+
+   // once full, the newest replace the oldest
+   for (int i = 0; i < 50; ++i)
+   {
+      sampler.AddSample(1.0);
+   }
+   test_assert(sampler.GetNumSamples() == 100);
+   test_assert(sampler.GetNumAdded() == 150);
+   test_assert(sampler.GetPercentile(50.0f) < 1.0);
+   test_assert(sampler.GetPercentile(51.0f) == 1.0);
+
+   sampler.Reset();
+   test_assert(sampler.GetNumSamples() == 0);
+   test_assert(sampler.GetNumAdded() == 0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/MeshTable.h>
+
+void testMesh()
+{
+   const unsigned int kProtocolID = 1234;
+   const unsigned short kMeshPort = 1269;
+   const unsigned short kFirstNodePort = 1270;
+   const net::Address kGroup(239, 255, 42, 99, 1273);
+   const int kNumNodes = 2;
+
+   // what comes through the group is only taken from the mesh's address, and
+   // the host sends to it from its outward interface, not from loopback; find
+   // that out by listening to the group for ourselves
+   net::Address meshAddress("127.0.0.1", kMeshPort);
+   {
+      net::Socket listener(net::Socket::NonBlocking | net::Socket::AllowMultiBind), sender;
+      test_assert(listener.Open(kGroup.GetPort()) && listener.Subscribe(kGroup));
+      test_assert(sender.Open(kMeshPort));
+      const unsigned char probe[] = "probe";
+      net::Address from;
+      unsigned char data[16];
+      bool heard = false;
+      for (int attempt = 0; attempt < 100 && !heard; ++attempt)
+      {
+         sender.Send(kGroup, probe, sizeof(probe));
+         OpenThreads::Thread::microSleep(1000);
+         while (!heard && listener.Receive(from, data, sizeof(data)) > 0)
+         {
+            heard = from.GetPort() == kMeshPort;
+         }
+      }
+      test_assert(heard);
+      meshAddress = net::Address(from.GetAddress(), kMeshPort);
+      listener.Unsubscribe(kGroup);
+   }
+
+   // test publishing the table to a multicast group
+   {
+      net::Mesh mesh(kProtocolID, 4);
+      mesh.SetMulticastGroup(kGroup);
+      test_assert(mesh.GetMulticastGroup() == kGroup);
+      test_assert(mesh.Start(kMeshPort));
+      test_assert(mesh.GetNumActiveNodes() == 0);
+      test_assert(mesh.FindFirstFreeNode() == 0);
+
+      net::Node* nodes[kNumNodes];
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i] = new net::Node(kProtocolID);
+         test_assert(nodes[i]->Start(kFirstNodePort + i));
+         nodes[i]->Connect(meshAddress);
+      }
+
+      // every node should connect, subscribe, and be known to hear the group
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const float kFrameTime = 0.05f; // run the clock faster than real time
+      bool allOnMulticast = false;
+      for (int frame = 0; frame < 400 && !allOnMulticast; ++frame)
+      {
+         mesh.Update(kFrameTime);
+         allOnMulticast = true;
+         for (int i = 0; i < kNumNodes; ++i)
+         {
+            nodes[i]->Update(kFrameTime);
+            allOnMulticast = allOnMulticast && nodes[i]->IsConnected() && mesh.IsNodeOnMulticast(nodes[i]->GetLocalNodeID());
+         }
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+      }
+      test_assert(allOnMulticast);
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         test_assert(nodes[i]->GetMulticastSubscription() == kGroup);
+      }
+
+      // only the slots taken are walked each tick
+      test_assert(mesh.GetNumActiveNodes() == kNumNodes);
+      test_assert(mesh.FindFirstFreeNode() == kNumNodes);
+
+      // a node that stops hearing the group gets the table directly again, and
+      // still learns of others joining
+      nodes[1]->UnsubscribeMulticast();
+      net::Node latecomer(kProtocolID);
+      test_assert(latecomer.Start(kFirstNodePort + kNumNodes));
+      latecomer.Connect(meshAddress);
+      bool fellBack = false;
+      for (int frame = 0; frame < 400 && !fellBack; ++frame)
+      {
+         mesh.Update(kFrameTime);
+         latecomer.Update(kFrameTime);
+         for (int i = 0; i < kNumNodes; ++i)
+         {
+            nodes[i]->Update(kFrameTime);
+         }
+         fellBack = !mesh.IsNodeOnMulticast(nodes[1]->GetLocalNodeID()) && latecomer.IsConnected() &&
+            nodes[1]->IsNodeConnected(latecomer.GetLocalNodeID()) && nodes[0]->IsNodeConnected(latecomer.GetLocalNodeID());
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+      }
+      test_assert(fellBack);
+      test_assert(nodes[1]->IsConnected());
+      test_assert(mesh.IsNodeOnMulticast(nodes[0]->GetLocalNodeID()));
+
+      // a node that reached the mesh at another of its addresses takes nothing
+      // from the group, not knowing it for the mesh's, and gets the table directly
+      if (meshAddress.GetAddress() != net::Address("127.0.0.1", kMeshPort).GetAddress())
+      {
+         const unsigned short kStrangerPort = 1280;
+         net::Node stranger(kProtocolID);
+         test_assert(stranger.Start(kStrangerPort));
+         stranger.Connect(net::Address("127.0.0.1", kMeshPort));
+         int framesSubscribed = 0;
+         for (int frame = 0; frame < 400 && framesSubscribed < 40; ++frame)
+         {
+            mesh.Update(kFrameTime);
+            stranger.Update(kFrameTime);
+            latecomer.Update(kFrameTime);
+            for (int i = 0; i < kNumNodes; ++i)
+            {
+               nodes[i]->Update(kFrameTime);
+            }
+            framesSubscribed += stranger.IsConnected() && stranger.GetMulticastSubscription() == kGroup ? 1 : 0;
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+         }
+         test_assert(framesSubscribed == 40);
+         test_assert(!mesh.IsNodeOnMulticast(stranger.GetLocalNodeID()));
+         test_assert(stranger.IsNodeConnected(nodes[0]->GetLocalNodeID()));
+         test_assert(mesh.IsNodeOnMulticast(nodes[0]->GetLocalNodeID()));
+         stranger.Stop();
+      }
+
+      latecomer.Stop();
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i]->Stop();
+         test_assert(nodes[i]->GetMulticastSubscription() == net::Address());
+         delete nodes[i];
+      }
+      mesh.Stop();
+   }
+
+   // test a mesh with more nodes than fit in a byte, or its table in a packet
+   {
+      const unsigned short kPagedMeshPort = 1274;
+      const unsigned short kFirstPagedNodePort = 1275;
+      const int kFirstNodeID = 300;
+      net::MeshTable table(2 * kFirstNodeID);
+      net::Mesh mesh(kProtocolID, table, kFirstNodeID, kFirstNodeID);
+      test_assert(mesh.UsesPagedTable());
+      test_assert(mesh.GetTablePageSize() * 6 < mesh.GetMaxPacketSize());
+      test_assert(mesh.Start(kPagedMeshPort));
+
+      net::Node* nodes[kNumNodes];
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i] = new net::Node(kProtocolID);
+         test_assert(nodes[i]->Start(kFirstPagedNodePort + i));
+         nodes[i]->Connect(net::Address("127.0.0.1", kPagedMeshPort));
+      }
+
+      // the nodes learn of each other once the page holding them comes round
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const float kFrameTime = 0.05f; // run the clock faster than real time
+      bool allConnected = false;
+      for (int frame = 0; frame < 1000 && !allConnected; ++frame)
+      {
+         mesh.Update(kFrameTime);
+         allConnected = true;
+         for (int i = 0; i < kNumNodes; ++i)
+         {
+            nodes[i]->Update(kFrameTime);
+            for (int j = 0; j < kNumNodes; ++j)
+            {
+               allConnected = allConnected && nodes[i]->IsConnected() && nodes[i]->IsNodeConnected(nodes[j]->GetLocalNodeID());
+            }
+         }
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+      }
+      test_assert(allConnected);
+
+      // from then on, nodes are only sent what changes, once they have acked the rest
+      bool allUpToDate = false;
+      for (int frame = 0; frame < 400 && !allUpToDate; ++frame)
+      {
+         mesh.Update(kFrameTime);
+         allUpToDate = true;
+         for (int i = 0; i < kNumNodes; ++i)
+         {
+            nodes[i]->Update(kFrameTime);
+            allUpToDate = allUpToDate && mesh.GetNodeTableVersion(nodes[i]->GetLocalNodeID()) == mesh.GetTableVersion();
+         }
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+      }
+      test_assert(allUpToDate);
+      test_assert(mesh.GetTableVersion() == unsigned(kNumNodes));
+
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         test_assert(nodes[i]->GetLocalNodeID() >= kFirstNodeID);
+         test_assert(nodes[i]->GetNumNodesReserved() == 2 * kFirstNodeID);
+         nodes[i]->Stop();
+         delete nodes[i];
+      }
+      mesh.Stop();
+   }
+
+   // test that, sending fast, nodes are known to have the table within a few
+   // round trips, whether it goes out whole or in pages
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      const unsigned short kFastMeshPort = pass == 0 ? 1277 : 1281; // each pass on ports of its own
+      const unsigned short kFirstFastNodePort = kFastMeshPort + 1;
+      const float kSendRate = 0.05f;
+      net::Mesh mesh(kProtocolID, 4, kSendRate);
+      mesh.SetPagedTable(pass == 1);
+      test_assert(mesh.UsesPagedTable() == (pass == 1));
+      test_assert(mesh.Start(kFastMeshPort));
+
+      net::Node* nodes[kNumNodes];
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i] = new net::Node(kProtocolID, kSendRate);
+         test_assert(nodes[i]->Start(kFirstFastNodePort + i));
+         nodes[i]->Connect(net::Address("127.0.0.1", kFastMeshPort));
+      }
+
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const float kFrameTime = 0.01f;
+      bool allConnected = false;
+      for (int frame = 0; frame < 1000 && !allConnected; ++frame)
+      {
+         mesh.Update(kFrameTime);
+         allConnected = true;
+         for (int i = 0; i < kNumNodes; ++i)
+         {
+            nodes[i]->Update(kFrameTime);
+            for (int j = 0; j < kNumNodes; ++j)
+            {
+               allConnected = allConnected && nodes[i]->IsConnected() && nodes[i]->IsNodeConnected(nodes[j]->GetLocalNodeID());
+            }
+         }
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+      }
+      test_assert(allConnected);
+
+      // within half a second, a few round trips, and well before the sends
+      // in flight wrap the ring of them kept per node
+      bool allUpToDate = false;
+      for (int frame = 0; frame < 50 && !allUpToDate; ++frame)
+      {
+         mesh.Update(kFrameTime);
+         allUpToDate = true;
+         for (int i = 0; i < kNumNodes; ++i)
+         {
+            nodes[i]->Update(kFrameTime);
+            allUpToDate = allUpToDate && mesh.GetNodeTableVersion(nodes[i]->GetLocalNodeID()) == mesh.GetTableVersion();
+         }
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+      }
+      test_assert(allUpToDate);
+      test_assert(mesh.GetTableVersion() == unsigned(kNumNodes));
+
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i]->Stop();
+         delete nodes[i];
+      }
+      mesh.Stop();
+   }
+
+   // test that the keyframes sent nodes on their own go round every page of a
+   // paged table, even when the number of pages divides the keyframe interval
+   {
+      const unsigned short kKeyframeMeshPort = 1284;
+      const float kSendRate = 0.25f;
+      const int kNumPages = 4;
+      const int pageSize = net::Mesh(kProtocolID).GetTablePageSize();
+      net::Mesh mesh(kProtocolID, kNumPages * pageSize, kSendRate);
+      test_assert(mesh.UsesPagedTable());
+      test_assert(mesh.Start(kKeyframeMeshPort));
+
+      std::set<net::NodeID> pages;
+      for (int frame = 0; frame < 2 * 16 * kNumPages; ++frame)
+      {
+         mesh.Update(kSendRate);
+         pages.insert(mesh.GetNextKeyframePage());
+      }
+      test_assert(int(pages.size()) == kNumPages);
+      for (std::set<net::NodeID>::const_iterator it = pages.begin(); it != pages.end(); ++it)
+      {
+         test_assert(*it % pageSize == 0);
+      }
+      mesh.Stop();
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/NetworkEngine.h>
+
+#if defined(__linux__)
+#   include <sched.h> // for sched_getcpu()
+#endif
+
+void testNetworkEngine()
+{
+   const unsigned short kMeshPort = 1265;
+   const unsigned short kNodePort = 1266;
+
+   // test the low latency profile
+   {
+      net::NetworkEngine& engine = net::NetworkEngine::GetRef();
+      net::NetworkEngine::LowLatencyProfile profile;
+#if defined(__linux__)
+      profile.mCpu = sched_getcpu(); // one we are allowed on
+#endif
+      profile.mSpinTime = 0.001f;
+      engine.SetLowLatencyProfile(profile);
+      test_assert(engine.UsesLowLatencyProfile());
+
+      test_assert(engine.GetMesh().Start(kMeshPort));
+      test_assert(engine.GetNode().Start(kNodePort));
+      engine.GetNode().Connect(net::Address("127.0.0.1", kMeshPort));
+
+      // packets come and go every quarter second, so this takes a couple of seconds
+      const int kNumSamples = 8;
+      const double start = net::Socket::GetTime();
+      double lastUpdate = start;
+      bool connected = false;
+      while (lastUpdate - start < 10.0 && engine.GetLowLatencyReport().mNumSamples < kNumSamples)
+      {
+         engine.WaitForWork(0.05f);
+         const double now = net::Socket::GetTime();
+         engine.Update(float(now - lastUpdate));
+         lastUpdate = now;
+         connected = connected || engine.GetNode().IsConnected();
+      }
+      test_assert(connected);
+
+      const net::NetworkEngine::LowLatencyReport report = engine.GetLowLatencyReport();
+      printf("low latency profile: busy polling %d, pinned %d, woken %u spinning and %u sleeping, dispatch latency p50 %.1fus p99 %.1fus over %d packets\n",
+         int(report.mBusyPolling), int(report.mPinned), report.mSpinWakeups, report.mSleepWakeups,
+         report.mDispatchLatency50 * 1000000.0, report.mDispatchLatency99 * 1000000.0, report.mNumSamples);
+#if defined(__linux__)
+      test_assert(report.mPinned);
+      test_assert(sched_getcpu() == profile.mCpu);
+#endif
+      test_assert(report.mSpinWakeups + report.mSleepWakeups > 0);
+      if (engine.GetNode().GetSocket().UsesTimestamps())
+      {
+         test_assert(report.mNumSamples >= kNumSamples);
+         test_assert(report.mDispatchLatency50 >= 0.0);
+         test_assert(report.mDispatchLatency99 >= report.mDispatchLatency50);
+         test_assert(report.mDispatchLatency99 < 1.0);
+      }
+
+      engine.ClearLowLatencyProfile();
+      test_assert(!engine.UsesLowLatencyProfile());
+      engine.GetNode().Stop();
+      engine.GetMesh().Stop();
+      net::NetworkEngine::Destroy();
+   }
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -258,6 +887,49 @@ zz;
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <NetSetGo/NetCore/PacketPool.h>
+
+void testPacketPool()
+{
+   net::PacketPool pool(64, 2);
+   test_assert(pool.GetBufferSize() == 64);
+   test_assert(pool.GetNumBuffers() == 2);
+   test_assert(pool.GetNumFree() == 2);
+
+   // buffers can be taken until the pool runs dry
+   net::PacketPool::Handle first = pool.Acquire();
+   net::PacketPool::Handle second = pool.Acquire();
+   test_assert(first.IsValid() && second.IsValid());
+   test_assert(first.GetData() != second.GetData());
+   test_assert(!pool.Acquire().IsValid());
+   test_assert(pool.GetNumFree() == 0);
+
+   // the buffer a pointer falls in can be shared, and only goes back once all let go
+   net::PacketPool::Handle shared = pool.Share(first.GetData() + 16);
+   test_assert(shared.IsValid());
+   test_assert(shared.GetData() == first.GetData());
+   first.Release();
+   test_assert(!first.IsValid());
+   test_assert(pool.GetNumFree() == 0);
+   shared = second;
+   test_assert(pool.GetNumFree() == 1);
+   test_assert(!pool.Share(first.GetData()).IsValid());
+
+   // nothing can be resized out from under a handle
+   test_assert(!pool.Resize(128));
+   second.Release();
+   shared.Release();
+   test_assert(pool.GetNumFree() == 2);
+   test_assert(pool.Resize(128));
+   test_assert(pool.GetBufferSize() == 128);
+
+   // a pointer from outside the pool isn't shared
+   unsigned char elsewhere[4];
+   test_assert(!pool.Share(elsewhere).IsValid());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 #include <NetSetGo/NetCore/PacketProcessor.h>
 #include <NetSetGo/NetCore/PacketParser.h>
 
@@ -422,11 +1094,479 @@ void testPacketQueue()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <NetSetGo/NetCore/Poller.h>
+
+void testPoller()
+{
+   const unsigned short kSenderPort   = 1240;
+   const unsigned short kReceiverPort = 1241;
+
+   net::Socket sender, receiver;
+   sender.Open(kSenderPort);
+   receiver.Open(kReceiverPort);
+   test_assert(sender.IsOpen());
+   test_assert(receiver.IsOpen());
+
+   net::Poller poller;
+   const net::Socket* sockets[] = { &receiver };
+
+   // nothing has been sent, so we should time out
+   test_assert(!poller.Wait(sockets, 1, 0.01f));
+
+   // once something is sent we should wake up
+   const char sendData[4] = { 1, 2, 3, 4 };
+   test_assert(sender.Send(net::Address("127.0.0.1", kReceiverPort), sendData, sizeof(sendData)));
+   test_assert(poller.Wait(sockets, 1, 3.0f));
+
+   // and once it has been read we should be back to timing out
+   char recvData[4];
+   net::Address senderAddress;
+   test_assert(receiver.Receive(senderAddress, recvData, sizeof(recvData)) == sizeof(sendData));
+   test_assert(!poller.Wait(sockets, 1, 0.0f));
+
+   // a reopened socket should still be watched
+   receiver.Close();
+   test_assert(!poller.Wait(sockets, 1, 0.0f));
+   receiver.Open(kReceiverPort);
+   test_assert(sender.Send(net::Address("127.0.0.1", kReceiverPort), sendData, sizeof(sendData)));
+   test_assert(poller.Wait(sockets, 1, 3.0f));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/ShardedMesh.h>
+#include <NetSetGo/NetCore/Node.h>
+
+void testShardedMesh()
+{
+   const unsigned int kProtocolID = 1234;
+   const unsigned short kMeshPort = 1250;
+   const unsigned short kFirstNodePort = 1251;
+   const int kNumNodes = 3;
+
+   // however the node IDs divide, there are as many shards as asked for,
+   // none more than one node bigger than another
+   {
+      const int kNumShards = 4;
+      const int kMaxNodes = 10; // ceil(10 / 4) per shard would fill only three
+      net::ShardedMesh uneven(kProtocolID, kNumShards, kMaxNodes);
+      test_assert(uneven.GetNumShards() == kNumShards);
+      int firstNodeID = 0;
+      for (int i = 0; i < kNumShards; ++i)
+      {
+         test_assert(uneven.GetShard(i).GetFirstNodeID() == firstNodeID);
+         const int numNodes = uneven.GetShard(i).GetNumNodesReserved();
+         test_assert(numNodes == kMaxNodes / kNumShards || numNodes == kMaxNodes / kNumShards + 1);
+         firstNodeID += numNodes;
+      }
+      test_assert(firstNodeID == kMaxNodes);
+   }
+
+   const int kNumShards = 2;
+   net::ShardedMesh mesh(kProtocolID, kNumShards, 8);
+   test_assert(mesh.GetNumShards() == kNumShards);
+   test_assert(mesh.GetShard(0).GetFirstNodeID() == 0);
+   test_assert(mesh.GetShard(1).GetFirstNodeID() == 4);
+   test_assert(mesh.Start(kMeshPort));
+
+   std::vector<net::Node*> nodes;
+   for (int i = 0; i < kNumNodes; ++i)
+   {
+      nodes.push_back(new net::Node(kProtocolID));
+      nodes.back()->SetConnectPeers(i == 0); // one talks to the others through sockets of their own
+      test_assert(nodes.back()->Start(kFirstNodePort + i));
+      nodes.back()->Connect(net::Address("127.0.0.1", kMeshPort));
+   }
+
+   // whichever shard each node lands on, every node should end up connected
+   // with an ID of its own, and see all the others through the shared table
+   const int kMicrosecondsToSleep = 1000; // 1 millisecond
+   const float kFrameTime = 0.05f; // run the clock faster than real time
+   bool allConnected = false;
+   for (int frame = 0; frame < 1000 && !allConnected; ++frame)
+   {
+      mesh.Update(kFrameTime);
+      allConnected = true;
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i]->Update(kFrameTime);
+         for (int j = 0; j < kNumNodes; ++j)
+         {
+            allConnected = allConnected && nodes[i]->IsConnected() && nodes[j]->IsConnected() &&
+               nodes[i]->IsNodeConnected(nodes[j]->GetLocalNodeID());
+         }
+      }
+      OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+   }
+   test_assert(allConnected);
+
+   // the mesh, and every other node, has a socket of its own
+   std::vector<const net::Socket*> sockets;
+   nodes[0]->GetSockets(sockets);
+   test_assert(sockets.size() == size_t(1 + kNumNodes));
+   test_assert(sockets[1]->GetPeer() == net::Address("127.0.0.1", kMeshPort));
+
+   // a node whose application holds every buffer of its pool still hears the
+   // mesh through a socket of its own, received into pooled buffers, so stays
+   // connected well past its time out
+   const int kNumPackets = 320;
+   const unsigned char payload[] = "held";
+   for (int i = 0; i < kNumPackets; ++i)
+   {
+      nodes[1]->SendPacket(nodes[0]->GetLocalNodeID(), payload, sizeof(payload));
+   }
+   for (int frame = 0; frame < 100; ++frame)
+   {
+      mesh.Update(kFrameTime);
+      for (int i = 0; i < kNumNodes; ++i)
+      {
+         nodes[i]->Update(kFrameTime);
+      }
+      OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+   }
+   test_assert(nodes[0]->IsConnected());
+   test_assert(nodes[0]->IsNodeConnected(nodes[2]->GetLocalNodeID()));
+   int numHeld = 0;
+   net::NodeID fromNodeID = net::NODEID_INVALID;
+   unsigned char received[16];
+   while (nodes[0]->ReceivePacket(fromNodeID, received, sizeof(received)) > 0)
+   {
+      test_assert(fromNodeID == nodes[1]->GetLocalNodeID());
+      ++numHeld;
+   }
+   test_assert(numHeld == 256); // one per buffer of the pool, the rest dropped
+
+   for (int i = 0; i < kNumNodes; ++i)
+   {
+      test_assert(nodes[i]->GetNumNodesReserved() == 8);
+      for (int j = 0; j < i; ++j)
+      {
+         test_assert(nodes[i]->GetLocalNodeID() != nodes[j]->GetLocalNodeID());
+      }
+   }
+
+   for (int i = 0; i < kNumNodes; ++i)
+   {
+      nodes[i]->Stop();
+      delete nodes[i];
+   }
+
+   mesh.Stop();
+   test_assert(!mesh.IsRunning());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/SharedMemoryTransport.h>
+#include <NetSetGo/NetCore/Mesh.h>
+
+void testSharedMemoryTransport()
+{
+   const unsigned short kOnePort   = 1261;
+   const unsigned short kOtherPort = 1262;
+   const net::Address oneAddress("127.0.0.1", kOnePort);
+   const net::Address otherAddress("127.0.0.1", kOtherPort);
+
+   // test sending and receiving, copied out and in place
+   {
+      net::SharedMemoryTransport one(64, 4), other(64, 4);
+      test_assert(!one.IsOpen());
+      test_assert(one.Open(kOnePort));
+      test_assert(one.IsOpen());
+      test_assert(one.GetPort() == kOnePort);
+      test_assert(other.Open(kOtherPort));
+
+      // a port can only be had once, and only on the local host
+      net::SharedMemoryTransport again;
+      test_assert(!again.Open(kOnePort));
+      const char sendData[3] = { 1, 2, 3 };
+      test_assert(!one.Send(net::Address("192.0.2.1", kOtherPort), sendData, sizeof(sendData)));
+
+      test_assert(one.Send(otherAddress, sendData, sizeof(sendData)));
+      char recvData[64];
+      net::Address senderAddress;
+      test_assert(other.Receive(senderAddress, recvData, sizeof(recvData)) == sizeof(sendData));
+      test_assert(senderAddress == oneAddress);
+      test_assert(memcmp(recvData, sendData, sizeof(sendData)) == 0);
+      test_assert(other.Receive(senderAddress, recvData, sizeof(recvData)) == 0);
+
+      // gathered pieces arrive as one datagram, readable where they landed
+      const char payload[5] = { 4, 5, 6, 7, 8 };
+      net::Transport::Buffer buffers[2];
+      buffers[0].mData = sendData;
+      buffers[0].mSize = sizeof(sendData);
+      buffers[1].mData = payload;
+      buffers[1].mSize = sizeof(payload);
+      test_assert(one.SendV(otherAddress, buffers, 2));
+      test_assert(other.ReceivesInPlace());
+      net::Transport::Datagram datagram;
+      test_assert(other.ReceiveInPlace(&datagram, 1) == 1);
+      test_assert(datagram.mAddress == oneAddress);
+      test_assert(datagram.mSize == int(sizeof(sendData) + sizeof(payload)));
+      test_assert(memcmp(datagram.mData, sendData, sizeof(sendData)) == 0);
+      test_assert(memcmp((const char*)datagram.mData + sizeof(sendData), payload, sizeof(payload)) == 0);
+      test_assert(datagram.mTime > 0.0);
+      other.ReleaseReceived();
+
+      // a full inbox turns senders away, and both ends count it
+      for (int i = 0; i < other.GetNumSlots(); ++i)
+      {
+         test_assert(one.Send(otherAddress, sendData, sizeof(sendData)));
+      }
+      test_assert(!one.Send(otherAddress, sendData, sizeof(sendData)));
+      test_assert(one.GetSendDrops() == 1);
+      test_assert(other.GetReceiveDrops() == 1);
+      char tooBig[65] = { 0 };
+      test_assert(!other.Send(oneAddress, tooBig, sizeof(tooBig)));
+      net::Transport::Datagram datagrams[8];
+      test_assert(other.ReceiveInPlace(datagrams, 8) == other.GetNumSlots());
+      other.ReleaseReceived();
+      test_assert(one.Send(otherAddress, sendData, sizeof(sendData)));
+
+      // a size that would run past the slot, as a corrupt or hostile sender
+      // could write it, is not believed; it sits just in front of the payload
+      const int hostileSize = 1 << 20;
+      memcpy(static_cast<char*>(datagrams[0].mData) - sizeof(int), &hostileSize, sizeof(int));
+      test_assert(other.ReceiveInPlace(&datagram, 1) == 1);
+      test_assert(datagram.mData == datagrams[0].mData);
+      test_assert(datagram.mSize == 0);
+      other.ReleaseReceived();
+      test_assert(one.Send(otherAddress, sendData, sizeof(sendData)));
+
+      // once closed, nobody is there to send to, and the port is free again
+      other.Close();
+      test_assert(!other.IsOpen());
+      test_assert(!one.Send(otherAddress, sendData, sizeof(sendData)));
+      test_assert(other.Open(kOtherPort));
+      test_assert(one.Send(otherAddress, sendData, sizeof(sendData)));
+      test_assert(other.Receive(senderAddress, recvData, sizeof(recvData)) == sizeof(sendData));
+   }
+
+   // test a mesh and a node talking through shared memory alone
+   {
+      const unsigned int kProtocolID = 1234;
+      net::SharedMemoryTransport meshTransport, nodeTransport;
+      net::Mesh mesh(kProtocolID, 4);
+      net::Node node(kProtocolID);
+      mesh.SetTransport(&meshTransport);
+      node.SetTransport(&nodeTransport);
+      test_assert(&mesh.GetTransport() == &meshTransport);
+      test_assert(mesh.Start(kOnePort));
+      test_assert(node.Start(kOtherPort));
+      node.Connect(oneAddress);
+
+      const float kFrameTime = 0.05f;
+      for (int frame = 0; frame < 100 && !node.IsConnected(); ++frame)
+      {
+         mesh.Update(kFrameTime);
+         node.Update(kFrameTime);
+      }
+      test_assert(node.IsConnected());
+      test_assert(!mesh.GetSocket().IsOpen());
+
+      node.Stop();
+      mesh.Stop();
+      test_assert(!meshTransport.IsOpen());
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 // todo: write ReliabilitySystem unit tests
 
 ////////////////////////////////////////////////////////////////////////////////
 
-// todo: write Serialization unit tests
+#include <NetSetGo/NetCore/ReliabilitySystem.h>
+
+void testReliabilitySystem()
+{
+   // a small max sequence, so it wraps along the way
+   const unsigned int kMaxSequence = 255;
+   net::ReliabilitySystem sender(kMaxSequence);
+   net::ReliabilitySystem receiver(kMaxSequence);
+
+   // every fifth packet is lost, and every other pair arrives swapped
+   unsigned int numArrived = 0;
+   for (int i = 0; i < 300; i += 2)
+   {
+      const unsigned int first = sender.GetLocalSequence();
+      sender.PacketSent(64);
+      const unsigned int second = sender.GetLocalSequence();
+      sender.PacketSent(64);
+      if (i % 5 != 0)
+      {
+         receiver.PacketReceived(second, 64);
+         receiver.PacketReceived(second, 64); // a duplicate changes nothing
+         ++numArrived;
+      }
+      if ((i + 1) % 5 != 0)
+      {
+         receiver.PacketReceived(first, 64);
+         ++numArrived;
+      }
+
+      // the ack bits say which of the 32 before were received
+      const unsigned int ack = receiver.GetRemoteSequence();
+      const unsigned int ackBits = receiver.GenerateAckBits();
+      test_assert(ack == second || ack == first);
+      if (ack == second && (i + 1) % 5 != 0)
+      {
+         test_assert(ackBits & 1);
+      }
+      sender.ProcessAck(ack, ackBits);
+      sender.Update(0.05f);
+      receiver.Update(0.05f);
+   }
+   test_assert(sender.GetLocalSequence() == 300 % (kMaxSequence + 1));
+   test_assert(sender.GetAckedPackets() == numArrived);
+   test_assert(sender.Validate());
+
+   // sending fast, packets waiting on acks within the maximum round trip
+   // aren't counted lost just for there being many of them
+   {
+      net::ReliabilitySystem fast;
+      for (int frame = 0; frame < 90; ++frame)
+      {
+         for (int i = 0; i < 10; ++i) // 1000 packets a second
+         {
+            fast.PacketSent(64);
+         }
+         fast.Update(0.01f);
+      }
+      test_assert(fast.GetLostPackets() == 0);
+      test_assert(fast.Validate());
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/SequenceBuffer.h>
+
+void testSequenceBuffer()
+{
+   const unsigned int kMaxSequence = 1000; // so the sequence wraps within the test
+   net::SequenceBuffer buffer(60, kMaxSequence);
+   test_assert(buffer.capacity() == 64);
+   test_assert(buffer.slots() == 0); // none until packets are held
+   test_assert(buffer.empty());
+   test_assert(!buffer.exists(0));
+
+   // packets go in out of order, across the wrap, and come out in order
+   const unsigned int kSequences[] = { 990, 995, 2, 985, 999, 0, 10 };
+   const int kNumSequences = sizeof(kSequences) / sizeof(kSequences[0]);
+   for (int i = 0; i < kNumSequences; ++i)
+   {
+      buffer.insert(net::PacketData(kSequences[i], float(i), 64));
+      test_assert(buffer.verify_sorted());
+   }
+   test_assert(buffer.size() == kNumSequences);
+   test_assert(buffer.slots() == 32); // enough for 985 to 10
+   for (int i = 0; i < kNumSequences; ++i)
+   {
+      test_assert(buffer.exists(kSequences[i]));
+   }
+   test_assert(buffer.front().mSequence == 985);
+   test_assert(buffer.back().mSequence == 10);
+   {
+      const unsigned int kInOrder[] = { 985, 990, 995, 999, 0, 2, 10 };
+      int count = 0;
+      for (net::SequenceBuffer::iterator itor = buffer.begin(); itor != buffer.end(); ++itor)
+      {
+         test_assert(itor->mSequence == kInOrder[count++]);
+      }
+      test_assert(count == kNumSequences);
+   }
+
+   // erasing while walking leaves the rest to be walked
+   for (net::SequenceBuffer::iterator itor = buffer.begin(); itor != buffer.end();)
+   {
+      itor = itor->mSequence < 500 ? buffer.erase(itor) : ++itor;
+   }
+   test_assert(buffer.size() == 4);
+   test_assert(!buffer.exists(2));
+   test_assert(buffer.back().mSequence == 999);
+   test_assert(buffer.verify_sorted());
+
+   // a newer packet pushes out the oldest that no longer fit, and one older
+   // than the ring reaches isn't kept
+   net::PacketQueue evicted;
+   buffer.insert(net::PacketData(55, 0.0f, 64), &evicted); // 985 and 990 are too far back
+   test_assert(evicted.size() == 2);
+   test_assert(evicted.front().mSequence == 985);
+   test_assert(buffer.front().mSequence == 995);
+   evicted.clear();
+   buffer.insert(net::PacketData(900, 0.0f, 64), &evicted);
+   test_assert(evicted.size() == 1 && evicted.front().mSequence == 900);
+   test_assert(!buffer.exists(900));
+   test_assert(buffer.slots() == buffer.capacity());
+   test_assert(buffer.verify_sorted());
+
+   buffer.clear();
+   test_assert(buffer.empty());
+   test_assert(!buffer.exists(995));
+   test_assert(buffer.slots() == buffer.capacity());
+   buffer.release();
+   test_assert(buffer.slots() == 0);
+   buffer.insert(net::PacketData(5, 0.0f, 64));
+   test_assert(buffer.exists(5));
+   test_assert(buffer.verify_sorted());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/Serialization.h>
+
+void testSerialization()
+{
+   // test variable length integers
+   {
+      const unsigned int values[] = { 0, 1, 127, 128, 300, 16383, 16384, 0xFFFFFFFF };
+      const size_t sizes[] = { 1, 1, 1, 2, 2, 2, 3, 5 };
+      for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); ++i)
+      {
+         unsigned char data[kMaxVarIntSize];
+         test_assert(WriteVarInt(data, values[i]) == sizes[i]);
+         unsigned int value = 0;
+         test_assert(ReadVarInt(data, sizes[i], value) == sizes[i]);
+         test_assert(value == values[i]);
+         test_assert(ReadVarInt(data, sizes[i] - 1, value) == 0); // cut short
+      }
+
+      const unsigned char tooLong[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+      unsigned int value = 0;
+      test_assert(ReadVarInt(tooLong, sizeof(tooLong), value) == 0);
+   }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <NetSetGo/NetCore/SlidingWindow.h>
+
+void testSlidingWindow()
+{
+   net::SlidingWindow window(1.0f, 4); // buckets of a quarter second
+   test_assert(window.GetTotal() == 0.0);
+
+   window.Add(100.0);
+   window.Advance(0.25f);
+   window.Add(50.0);
+   window.Add();
+   test_assert(window.GetTotal() == 151.0);
+   test_assert(window.GetRate() == 151.0);
+
+   // the first bucket drops out once the window has moved past it
+   window.Advance(0.5f);
+   test_assert(window.GetTotal() == 151.0);
+   window.Advance(0.25f);
+   test_assert(window.GetTotal() == 51.0);
+   window.Advance(0.25f);
+   test_assert(window.GetTotal() == 0.0);
+
+   // and a long wait empties the lot
+   window.Add(10.0);
+   window.Advance(100.0f);
+   test_assert(window.GetTotal() == 0.0);
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -584,6 +1724,522 @@ void testSocket()
       test_assert(timeOut < kMaxSecondsToWait);
    }
 
+   // test batched sending and receiving
+   {
+      const unsigned short kSenderPort   = 1238;
+      const unsigned short kReceiverPort = 1239;
+      const int kBatchSize = 8;
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      net::Socket sender, receiver;
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+
+      // each datagram carries its own index so we can tell them apart
+      const std::string localhostIP = "127.0.0.1";
+      unsigned char sendData[kBatchSize][4];
+      net::Socket::Datagram outgoing[kBatchSize];
+      for (int i = 0; i < kBatchSize; ++i)
+      {
+         memset(sendData[i], i, sizeof(sendData[i]));
+         outgoing[i].mAddress = net::Address(localhostIP, kReceiverPort);
+         outgoing[i].mData = sendData[i];
+         outgoing[i].mSize = sizeof(sendData[i]);
+      }
+      const int numSent = sender.SendBatch(outgoing, kBatchSize);
+      test_assert(numSent == kBatchSize);
+
+      // receive them all back, possibly over several calls
+      unsigned char recvData[kBatchSize][16];
+      int numReceived = 0;
+      float timeOut = 0.0f;
+      while (numReceived < kBatchSize && timeOut < kMaxSecondsToWait)
+      {
+         net::Socket::Datagram incoming[kBatchSize];
+         for (int i = 0; i < kBatchSize; ++i)
+         {
+            incoming[i].mData = recvData[i];
+            incoming[i].mSize = sizeof(recvData[i]);
+         }
+
+         const int count = receiver.ReceiveBatch(incoming, kBatchSize - numReceived);
+         for (int i = 0; i < count; ++i)
+         {
+            // datagrams arrive in order over loopback
+            test_assert(incoming[i].mSize == sizeof(sendData[0]));
+            test_assert(memcmp(recvData[i], sendData[numReceived + i], incoming[i].mSize) == 0);
+            test_assert(incoming[i].mAddress == net::Address(localhostIP, kSenderPort));
+         }
+         numReceived += count;
+
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+         timeOut += kFrameTime;
+      }
+
+      test_assert(numReceived == kBatchSize);
+
+      // nothing more should be waiting
+      {
+         net::Socket::Datagram incoming;
+         incoming.mData = recvData[0];
+         incoming.mSize = sizeof(recvData[0]);
+         test_assert(receiver.ReceiveBatch(&incoming, 1) == 0);
+      }
+   }
+
+   // test io_uring sockets (these quietly use plain system calls where io_uring is unavailable)
+   {
+      const unsigned short kSenderPort   = 1242;
+      const unsigned short kReceiverPort = 1243;
+      const int kBatchSize = 8;
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      net::Socket sender(net::Socket::NonBlocking | net::Socket::IoUring);
+      net::Socket receiver(net::Socket::NonBlocking | net::Socket::IoUring);
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+
+      const std::string localhostIP = "127.0.0.1";
+      unsigned char sendData[kBatchSize][4];
+      net::Socket::Datagram outgoing[kBatchSize];
+      for (int i = 0; i < kBatchSize; ++i)
+      {
+         memset(sendData[i], i, sizeof(sendData[i]));
+         outgoing[i].mAddress = net::Address(localhostIP, kReceiverPort);
+         outgoing[i].mData = sendData[i];
+         outgoing[i].mSize = sizeof(sendData[i]);
+      }
+      test_assert(sender.SendBatch(outgoing, kBatchSize) == kBatchSize);
+
+      // receive in place when we can, copying out otherwise
+      unsigned char recvData[kBatchSize][16];
+      int numReceived = 0;
+      float timeOut = 0.0f;
+      while (numReceived < kBatchSize && timeOut < kMaxSecondsToWait)
+      {
+         net::Socket::Datagram incoming[kBatchSize];
+         for (int i = 0; i < kBatchSize; ++i)
+         {
+            incoming[i].mData = recvData[i];
+            incoming[i].mSize = sizeof(recvData[i]);
+         }
+
+         const int count = receiver.UsesIoUring()
+            ? receiver.ReceiveInPlace(incoming, kBatchSize - numReceived)
+            : receiver.ReceiveBatch(incoming, kBatchSize - numReceived);
+         for (int i = 0; i < count; ++i)
+         {
+            test_assert(incoming[i].mSize == sizeof(sendData[0]));
+            test_assert(memcmp(incoming[i].mData, sendData[numReceived + i], incoming[i].mSize) == 0);
+            test_assert(incoming[i].mAddress == net::Address(localhostIP, kSenderPort));
+         }
+         receiver.ReleaseReceived();
+         numReceived += count;
+
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+         timeOut += kFrameTime;
+      }
+
+      test_assert(numReceived == kBatchSize);
+
+      // and the copying calls work on top of io_uring too
+      test_assert(sender.Send(net::Address(localhostIP, kReceiverPort), sendData[1], sizeof(sendData[1])));
+      net::Address senderAddress;
+      int bytesRead = 0;
+      timeOut = 0.0f;
+      while (bytesRead == 0 && timeOut < kMaxSecondsToWait)
+      {
+         bytesRead = receiver.Receive(senderAddress, recvData[0], sizeof(recvData[0]));
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+         timeOut += kFrameTime;
+      }
+      test_assert(bytesRead == sizeof(sendData[1]));
+      test_assert(memcmp(recvData[0], sendData[1], bytesRead) == 0);
+      test_assert(senderAddress == net::Address(localhostIP, kSenderPort));
+   }
+
+   // test segmented sending
+   {
+      const unsigned short kSenderPort   = 1244;
+      const unsigned short kReceiverPort = 1245;
+      const int kSegmentSize = 4;
+      const int kNumSegments = 6; // the last one is short
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      net::Socket sender, receiver;
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+
+      // every segment is filled with its own index
+      const std::string localhostIP = "127.0.0.1";
+      unsigned char sendData[kNumSegments * kSegmentSize];
+      for (int i = 0; i < int(sizeof(sendData)); ++i)
+      {
+         sendData[i] = (unsigned char)(i / kSegmentSize);
+      }
+      const int sendSize = int(sizeof(sendData)) - kSegmentSize / 2;
+      const int numSent = sender.SendSegments(net::Address(localhostIP, kReceiverPort), sendData, sendSize, kSegmentSize);
+      test_assert(numSent == kNumSegments);
+
+      // each segment arrives as a datagram of its own
+      int numReceived = 0;
+      float timeOut = 0.0f;
+      while (numReceived < kNumSegments && timeOut < kMaxSecondsToWait)
+      {
+         unsigned char recvData[16];
+         net::Address senderAddress;
+         const int bytesRead = receiver.Receive(senderAddress, recvData, sizeof(recvData));
+         if (bytesRead > 0)
+         {
+            const bool last = numReceived == kNumSegments - 1;
+            test_assert(bytesRead == (last ? kSegmentSize / 2 : kSegmentSize));
+            test_assert(recvData[0] == numReceived);
+            test_assert(senderAddress == net::Address(localhostIP, kSenderPort));
+            ++numReceived;
+         }
+         else
+         {
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+            timeOut += kFrameTime;
+         }
+      }
+
+      test_assert(numReceived == kNumSegments);
+   }
+
+   // test gathered sending
+   {
+      const unsigned short kSenderPort   = 1248;
+      const unsigned short kReceiverPort = 1249;
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      net::Socket sender, receiver;
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+
+      // the pieces go out as one datagram, in order
+      const std::string localhostIP = "127.0.0.1";
+      const char header[3] = { 1, 2, 3 };
+      const char payload[5] = { 4, 5, 6, 7, 8 };
+      net::Socket::Buffer buffers[2];
+      buffers[0].mData = header;
+      buffers[0].mSize = sizeof(header);
+      buffers[1].mData = payload;
+      buffers[1].mSize = sizeof(payload);
+      test_assert(sender.SendV(net::Address(localhostIP, kReceiverPort), buffers, 2));
+
+      int bytesRead = 0;
+      char recvData[16];
+      float timeOut = 0.0f;
+      while (bytesRead <= 0 && timeOut < kMaxSecondsToWait)
+      {
+         net::Address senderAddress;
+         bytesRead = receiver.Receive(senderAddress, recvData, sizeof(recvData));
+         if (bytesRead <= 0)
+         {
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+            timeOut += kFrameTime;
+         }
+      }
+
+      test_assert(bytesRead == int(sizeof(header) + sizeof(payload)));
+      for (int i = 0; i < bytesRead; ++i)
+      {
+         test_assert(recvData[i] == i + 1);
+      }
+   }
+
+   // test timestamped receiving (stamps are only required where the kernel supports them)
+   {
+      const unsigned short kSenderPort   = 1254;
+      const unsigned short kReceiverPort = 1255;
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      net::Socket sender, receiver(net::Socket::NonBlocking | net::Socket::Timestamps);
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+
+      const double sendTime = net::Socket::GetTime();
+      const char sendData[4] = { 1, 2, 3, 4 };
+      test_assert(sender.Send(net::Address("127.0.0.1", kReceiverPort), sendData, sizeof(sendData)));
+
+      // the stamp is when the datagram arrived, not when we got around to reading it
+      char recvData[16];
+      net::Socket::Datagram incoming;
+      incoming.mData = recvData;
+      incoming.mSize = sizeof(recvData);
+      incoming.mTime = -1.0;
+      int numReceived = 0;
+      float timeOut = 0.0f;
+      while (numReceived == 0 && timeOut < kMaxSecondsToWait)
+      {
+         OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+         timeOut += kFrameTime;
+         numReceived = receiver.ReceiveBatch(&incoming, 1);
+      }
+      const double readTime = net::Socket::GetTime();
+
+      test_assert(numReceived == 1);
+      test_assert(incoming.mSize == sizeof(sendData));
+      if (receiver.UsesTimestamps())
+      {
+         test_assert(incoming.mTime >= sendTime - 0.001);
+         test_assert(incoming.mTime < readTime - 0.0005); // we slept at least a millisecond before reading
+      }
+      else
+      {
+         test_assert(incoming.mTime == 0.0);
+      }
+   }
+
+   // test buffer sizing, and counting what overflows the receive buffer
+   {
+      const unsigned short kSenderPort   = 1256;
+      const unsigned short kReceiverPort = 1257;
+      const int kNumDatagrams = 256;
+
+      net::Socket sender, receiver(net::Socket::NonBlocking | net::Socket::AutoTuneBuffers);
+      receiver.SetBufferSizes(4096, 0);
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+      test_assert(!sender.IsOpen() || sender.GetReceiveBufferSize() > 0);
+      test_assert(receiver.GetReceiveDrops() == 0);
+      test_assert(sender.GetSendDrops() == 0);
+
+      // a burst far bigger than the buffer has to overflow it
+      const int receiveBufferSize = receiver.GetReceiveBufferSize();
+      unsigned char sendData[1024] = { 0 };
+      for (int i = 0; i < kNumDatagrams; ++i)
+      {
+         sender.Send(net::Address("127.0.0.1", kReceiverPort), sendData, sizeof(sendData));
+      }
+      OpenThreads::Thread::microSleep(10000);
+
+      unsigned char recvData[4][1024];
+      net::Socket::Datagram incoming[4];
+      int numReceived = 0;
+      int result = 0;
+      do
+      {
+         for (int i = 0; i < 4; ++i)
+         {
+            incoming[i].mData = recvData[i];
+            incoming[i].mSize = sizeof(recvData[i]);
+         }
+         result = receiver.ReceiveBatch(incoming, 4);
+         numReceived += result;
+      }
+      while (result > 0);
+
+      test_assert(numReceived > 0);
+      test_assert(numReceived < kNumDatagrams);
+#if defined(__linux__)
+      // the kernel tells us about drops with the next datagram to arrive after
+      // them, and the buffer grows in answer
+      sender.Send(net::Address("127.0.0.1", kReceiverPort), sendData, sizeof(sendData));
+      OpenThreads::Thread::microSleep(10000);
+      incoming[0].mData = recvData[0];
+      incoming[0].mSize = sizeof(recvData[0]);
+      test_assert(receiver.ReceiveBatch(incoming, 1) == 1);
+      test_assert(receiver.GetReceiveDrops() > 0);
+      test_assert(receiver.GetReceiveDrops() <= unsigned(kNumDatagrams - numReceived));
+      test_assert(receiver.GetReceiveBufferSize() > receiveBufferSize);
+#else
+      (void)receiveBufferSize;
+#endif
+   }
+
+   // test busy polling (the kernel may turn it down without CAP_NET_ADMIN)
+   {
+      const unsigned short kSenderPort   = 1267;
+      const unsigned short kReceiverPort = 1268;
+
+      net::Socket sender, receiver(net::Socket::BusyPoll);
+      receiver.SetBusyPollTime(20);
+      test_assert(receiver.GetBusyPollTime() == 20);
+      test_assert(sender.Open(kSenderPort));
+      test_assert(receiver.Open(kReceiverPort));
+#if !defined(__linux__)
+      test_assert(!receiver.UsesBusyPoll());
+#endif
+
+      // a blocking receive, which is where busy polling comes in
+      const char sendData[] = "busy";
+      test_assert(sender.Send(net::Address("127.0.0.1", kReceiverPort), sendData, sizeof(sendData)));
+      char recvData[16];
+      net::Address from;
+      test_assert(receiver.Receive(from, recvData, sizeof(recvData)) == sizeof(sendData));
+      test_assert(strcmp(recvData, sendData) == 0);
+   }
+
+   // test connected sockets sharing a port with an unconnected one
+   {
+      const unsigned short kSharedPort   = 1258;
+      const unsigned short kPeerPort     = 1259;
+      const unsigned short kStrangerPort = 1260;
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      const std::string localhostIP = "127.0.0.1";
+      const net::Address peerAddress(localhostIP, kPeerPort);
+      net::Socket shared(net::Socket::NonBlocking | net::Socket::AllowMultiBind);
+      net::Socket connected(net::Socket::NonBlocking | net::Socket::AllowMultiBind);
+      net::Socket peer, stranger;
+      test_assert(shared.Open(kSharedPort));
+      test_assert(connected.Open(kSharedPort));
+      test_assert(peer.Open(kPeerPort));
+      test_assert(stranger.Open(kStrangerPort));
+      test_assert(connected.GetPeer() == net::Address());
+      test_assert(connected.Connect(peerAddress));
+      test_assert(connected.GetPeer() == peerAddress);
+
+      // the peer hears from the shared port, whichever socket sent it
+      const char sendData[3] = { 1, 2, 3 };
+      test_assert(connected.Send(peerAddress, sendData, sizeof(sendData)));
+      int bytesRead = 0;
+      char recvData[16];
+      net::Address senderAddress;
+      float timeOut = 0.0f;
+      while (bytesRead <= 0 && timeOut < kMaxSecondsToWait)
+      {
+         bytesRead = peer.Receive(senderAddress, recvData, sizeof(recvData));
+         if (bytesRead <= 0)
+         {
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+            timeOut += kFrameTime;
+         }
+      }
+      test_assert(bytesRead == sizeof(sendData));
+      test_assert(senderAddress == net::Address(localhostIP, kSharedPort));
+
+      // and what the peer sends back goes to the connected socket alone
+      test_assert(peer.Send(net::Address(localhostIP, kSharedPort), sendData, sizeof(sendData)));
+      bytesRead = 0;
+      timeOut = 0.0f;
+      while (bytesRead <= 0 && timeOut < kMaxSecondsToWait)
+      {
+         bytesRead = connected.Receive(senderAddress, recvData, sizeof(recvData));
+         if (bytesRead <= 0)
+         {
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+            timeOut += kFrameTime;
+         }
+      }
+      test_assert(bytesRead == sizeof(sendData));
+      test_assert(senderAddress == peerAddress);
+      test_assert(shared.Receive(senderAddress, recvData, sizeof(recvData)) <= 0);
+
+      // while everyone else is still heard on the unconnected socket
+      test_assert(stranger.Send(net::Address(localhostIP, kSharedPort), sendData, sizeof(sendData)));
+      bytesRead = 0;
+      timeOut = 0.0f;
+      while (bytesRead <= 0 && timeOut < kMaxSecondsToWait)
+      {
+         bytesRead = shared.Receive(senderAddress, recvData, sizeof(recvData));
+         if (bytesRead <= 0)
+         {
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+            timeOut += kFrameTime;
+         }
+      }
+      test_assert(bytesRead == sizeof(sendData));
+      test_assert(senderAddress == net::Address(localhostIP, kStrangerPort));
+      test_assert(connected.Receive(senderAddress, recvData, sizeof(recvData)) <= 0);
+
+      connected.Close();
+      test_assert(connected.GetPeer() == net::Address());
+   }
+
+   // test coalesced receiving, with and without io_uring
+   for (int pass = 0; pass < 2; ++pass)
+   {
+      const unsigned short kSenderPort   = 1246;
+      const unsigned short kReceiverPort = 1247;
+      const int kSegmentSize = 4;
+      const int kNumSegments = 6; // the last one is short
+
+      const float kMaxSecondsToWait  = 3.0f;
+      const int kMicrosecondsToSleep = 1000; // 1 millisecond
+      const double kFrameTime = 1.0 / 1000000.0 * kMicrosecondsToSleep; // time to sleep in seconds
+
+      const int receiverOptions = net::Socket::NonBlocking | net::Socket::ReceiveOffload | (pass ? net::Socket::IoUring : 0);
+      net::Socket sender, receiver(receiverOptions);
+      sender.Open(kSenderPort);
+      receiver.Open(kReceiverPort);
+      test_assert(sender.IsOpen());
+      test_assert(receiver.IsOpen());
+
+      const std::string localhostIP = "127.0.0.1";
+      unsigned char sendData[kNumSegments * kSegmentSize];
+      for (int i = 0; i < int(sizeof(sendData)); ++i)
+      {
+         sendData[i] = (unsigned char)(i / kSegmentSize);
+      }
+      const int sendSize = int(sizeof(sendData)) - kSegmentSize / 2;
+      test_assert(sender.SendSegments(net::Address(localhostIP, kReceiverPort), sendData, sendSize, kSegmentSize) == kNumSegments);
+
+      // whether or not the kernel coalesced them, splitting each datagram by
+      // its segment size gives back the segments in order
+      static unsigned char recvData[65536];
+      int numReceived = 0;
+      float timeOut = 0.0f;
+      while (numReceived < kNumSegments && timeOut < kMaxSecondsToWait)
+      {
+         net::Socket::Datagram incoming;
+         incoming.mData = recvData;
+         incoming.mSize = sizeof(recvData);
+         if (receiver.ReceiveBatch(&incoming, 1) == 1)
+         {
+            test_assert(incoming.mSegmentSize > 0);
+            test_assert(incoming.mAddress == net::Address(localhostIP, kSenderPort));
+            for (int offset = 0; offset < incoming.mSize; offset += incoming.mSegmentSize)
+            {
+               const bool last = numReceived == kNumSegments - 1;
+               const int segment = (incoming.mSize - offset) < incoming.mSegmentSize ? (incoming.mSize - offset) : incoming.mSegmentSize;
+               test_assert(segment == (last ? kSegmentSize / 2 : kSegmentSize));
+               test_assert(recvData[offset] == numReceived);
+               ++numReceived;
+            }
+         }
+         else
+         {
+            OpenThreads::Thread::microSleep(kMicrosecondsToSleep);
+            timeOut += kFrameTime;
+         }
+      }
+
+      test_assert(numReceived == kNumSegments);
+   }
+
    // test broadcast sockets
    {
       const unsigned short kSenderPort   = 1236;
@@ -668,6 +2324,58 @@ void testSocket()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <NetSetGo/NetCore/TimerWheel.h>
+
+void testTimerWheel()
+{
+   const float kTick = 1.0f / 64.0f;
+   net::TimerWheel wheel(kTick, 5);
+   test_assert(wheel.GetNumScheduled() == 0);
+
+   wheel.Schedule(0, 0.1f); // due on tick 7
+   wheel.Schedule(1, 2.0f); // 128, a level up
+   wheel.Schedule(2, 100.0f); // 6400, two levels up
+   wheel.Schedule(3, 0.5f);
+   wheel.Cancel(3);
+   wheel.Schedule(4, 1.0f);
+   wheel.Schedule(4, 3.0f); // re-armed, now due on tick 192
+   test_assert(wheel.GetNumScheduled() == 4);
+   test_assert(!wheel.IsScheduled(3));
+
+   // each timer comes due on its own tick, and not before
+   const int kDueTicks[] = { 7, 128, 6400, -1, 192 };
+   std::vector<int> expired;
+   int numExpired = 0;
+   for (int tick = 1; tick <= 6400; ++tick)
+   {
+      const float timeUntilNext = wheel.GetTimeUntilNext();
+      expired.clear();
+      wheel.Advance(kTick, expired);
+      for (size_t i = 0; i < expired.size(); ++i)
+      {
+         test_assert(kDueTicks[expired[i]] == tick);
+         test_assert(timeUntilNext <= kTick);
+         ++numExpired;
+      }
+   }
+   test_assert(numExpired == 4);
+   test_assert(wheel.GetNumScheduled() == 0);
+
+   // pushing a timer back again and again keeps it from coming due
+   wheel.Schedule(0, 0.5f);
+   for (int i = 0; i < 100; ++i)
+   {
+      expired.clear();
+      wheel.Advance(0.25f, expired);
+      test_assert(expired.empty());
+      wheel.Schedule(0, 0.5f);
+   }
+   wheel.CancelAll();
+   test_assert(!wheel.IsScheduled(0));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 int main(int argc, char *argv[])
 {
    {
@@ -676,10 +2384,24 @@ int main(int argc, char *argv[])
    }
 
    testAddress();
+   testAddressMap();
    testBeacon();
+   testImpairedTransport();
+   testLatencySampler();
+   testMesh();
+   testNetworkEngine();
+   testPacketPool();
    testPacketProcessor();
    testPacketQueue();
+   testPoller();
+   testReliabilitySystem();
+   testSequenceBuffer();
+   testSerialization();
+   testShardedMesh();
+   testSharedMemoryTransport();
+   testSlidingWindow();
    testSocket();
+   testTimerWheel();
 
    {
       net::ShutdownSockets();